@@ -0,0 +1,67 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "block_compression.h"
+#include "stb_image.h"
+
+// Encoder throughput (megapixels per second) and PSNR for every block
+// format and quality, with the SIMD index search and with the scalar one.
+//
+//   bc_encoder_bench [image] [repeats]
+
+namespace
+{
+  using Clock = std::chrono::steady_clock;
+
+  double secondsSince(Clock::time_point start)
+  {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const char* path = argc > 1 ? argv[1] : "data/textures/container.jpg";
+  int repeats = argc > 2 ? std::atoi(argv[2]) : 3;
+
+  int width, height, channels;
+  unsigned char* pixels = stbi_load(path, &width, &height, &channels, 4);
+  if (!pixels)
+  {
+    std::cout << "ERROR::BC_ENCODER_BENCH::DECODE_FAILED " << path << ": " << stbi_failure_reason() << std::endl;
+    return 1;
+  }
+  std::cout << path << ": " << width << "x" << height << ", " << repeats << " repeats" << std::endl;
+
+  const char* names[] = { "BC1", "BC3", "BC7" };
+  double megapixels = static_cast<double>(width) * height * repeats / 1e6;
+  for (BlockFormat format : { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC7 })
+  {
+    for (int quality = 0; quality <= 2; quality++)
+    {
+      for (bool simd : { true, false })
+      {
+        BlockEncoderOptions options;
+        options.format = format;
+        options.quality = quality;
+        options.simd = simd;
+
+        std::vector<unsigned char> blocks;
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < repeats; i++)
+          blocks = compressImage(pixels, width, height, 4, options);
+        double seconds = secondsSince(start);
+
+        std::vector<unsigned char> decoded = decompressImage(blocks.data(), width, height, format);
+        double decibels = psnr(pixels, 4, decoded.data(), 4, width, height, format == BlockFormat::BC1 ? 3 : 4);
+        std::cout << names[static_cast<int>(format)] << " q" << quality << " " << blockEncoderPath(options) << ": "
+                  << megapixels / seconds << " MP/s, PSNR " << decibels << " dB" << std::endl;
+      }
+    }
+  }
+
+  stbi_image_free(pixels);
+  return 0;
+}
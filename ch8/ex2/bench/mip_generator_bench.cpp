@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "block_compression.h"
+#include "mip_chain.h"
+#include "mip_generator.h"
+#include "stb_image.h"
+
+// Mip chain throughput (megapixels of the source per second) of the scalar
+// reference, buildMipChain(), against the generator's filters with the
+// SIMD kernels and with the scalar ones, and of clamping the image to a
+// quarter of its size. PSNR is of level 1 against the reference's.
+//
+//   mip_generator_bench [image] [repeats]
+
+namespace
+{
+  using Clock = std::chrono::steady_clock;
+
+  double secondsSince(Clock::time_point start)
+  {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const char* path = argc > 1 ? argv[1] : "data/textures/awesomeface.png";
+  int repeats = argc > 2 ? std::atoi(argv[2]) : 5;
+
+  int width, height, channels;
+  unsigned char* pixels = stbi_load(path, &width, &height, &channels, 0);
+  if (!pixels)
+  {
+    std::cout << "ERROR::MIP_GENERATOR_BENCH::DECODE_FAILED " << path << ": " << stbi_failure_reason() << std::endl;
+    return 1;
+  }
+  std::cout << path << ": " << width << "x" << height << ", " << channels << " channels, " << repeats << " repeats"
+            << std::endl;
+
+  double megapixels = static_cast<double>(width) * height * repeats / 1e6;
+  std::vector<MipLevel> reference;
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < repeats; i++)
+    reference = buildMipChain(pixels, width, height, channels, true);
+  std::cout << "buildMipChain: " << megapixels / secondsSince(start) << " MP/s" << std::endl;
+
+  const char* filters[] = { "box", "kaiser" };
+  const char* alphas[] = { "separate", "weighted" };
+  for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser })
+  {
+    for (MipOptions::Alpha alpha : { MipOptions::Alpha::Separate, MipOptions::Alpha::Weighted })
+    {
+      for (bool simd : { true, false })
+      {
+        MipOptions options;
+        options.filter = filter;
+        options.alpha = alpha;
+        options.simd = simd;
+
+        std::vector<MipLevel> chain;
+        start = Clock::now();
+        for (int i = 0; i < repeats; i++)
+          chain = generateMipChain(pixels, width, height, channels, options);
+        double seconds = secondsSince(start);
+
+        double decibels = chain.size() > 1 ? psnr(reference[1].pixels.data(), channels, chain[1].pixels.data(),
+                                                  channels, chain[1].width, chain[1].height, channels)
+                                           : 0.0;
+        std::cout << filters[static_cast<int>(filter)] << " " << alphas[static_cast<int>(alpha)] << " "
+                  << mipGeneratorPath(options) << ": " << megapixels / seconds << " MP/s, PSNR " << decibels << " dB"
+                  << std::endl;
+      }
+    }
+  }
+
+  for (bool simd : { true, false })
+  {
+    MipOptions options;
+    options.maxSize = std::max(std::max(width, height) / 4, 1);
+    options.simd = simd;
+    MipLevel level{};
+    start = Clock::now();
+    for (int i = 0; i < repeats; i++)
+      level = downscaleToFit(pixels, width, height, channels, options);
+    std::cout << "downscaleToFit " << options.maxSize << " " << mipGeneratorPath(options) << ": "
+              << megapixels / secondsSince(start) << " MP/s, " << level.width << "x" << level.height << std::endl;
+  }
+
+  stbi_image_free(pixels);
+  return 0;
+}
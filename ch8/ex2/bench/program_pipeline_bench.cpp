@@ -0,0 +1,122 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "program_pipelines.h"
+#include "shader.h"
+
+// Builds every pairing of N vertex and M fragment variants twice: as N x M
+// linked programs, and as N + M separable stages combined by
+// ProgramPipelines. Each variant gets a unique define so neither run is
+// served from the driver's own shader cache.
+//
+//   program_pipeline_bench [vertex variants] [fragment variants]
+
+namespace
+{
+  using Clock = std::chrono::steady_clock;
+
+  double millisecondsSince(Clock::time_point start)
+  {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  }
+
+  std::string uniqueDefine(int run, const char* stage, int index)
+  {
+    return "BENCH_" + std::string(stage) + "_" + std::to_string(run) + "_" + std::to_string(index);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  int vertexCount = argc > 1 ? std::atoi(argv[1]) : 8;
+  int fragmentCount = argc > 2 ? std::atoi(argv[2]) : 8;
+
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+  GLFWwindow* window = glfwCreateWindow(64, 64, "program_pipeline_bench", NULL, NULL);
+  if (window == NULL)
+  {
+    std::cout << "Failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    return -1;
+  }
+  glfwMakeContextCurrent(window);
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+  {
+    std::cout << "Failed to initialize GLAD" << std::endl;
+    return -1;
+  }
+  std::cout << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+  if (!Shader::separateStagesSupported())
+  {
+    std::cout << "GL_ARB_separate_shader_objects not supported" << std::endl;
+    glfwTerminate();
+    return 0;
+  }
+
+  // a program per pairing: every combination is compiled and linked
+  Clock::time_point start = Clock::now();
+  std::vector<std::unique_ptr<Shader>> programs;
+  for (int v = 0; v < vertexCount; v++)
+  {
+    for (int f = 0; f < fragmentCount; f++)
+    {
+      ShaderOptions options;
+      options.defines = { uniqueDefine(0, "VERTEX", v), uniqueDefine(0, "FRAGMENT", f) };
+      programs.push_back(std::make_unique<Shader>("data/shaders/shader.vs", "data/shaders/shader.fs", options));
+    }
+  }
+  double programTime = millisecondsSince(start);
+
+  // a stage per variant, then a pipeline per pairing
+  start = Clock::now();
+  std::vector<Shader> vertexStages, fragmentStages;
+  for (int v = 0; v < vertexCount; v++)
+  {
+    ShaderOptions options;
+    options.defines = { uniqueDefine(1, "VERTEX", v) };
+    vertexStages.push_back(Shader::stage(GL_VERTEX_SHADER, "data/shaders/shader.vs", options));
+  }
+  for (int f = 0; f < fragmentCount; f++)
+  {
+    ShaderOptions options;
+    options.defines = { uniqueDefine(1, "FRAGMENT", f) };
+    fragmentStages.push_back(Shader::stage(GL_FRAGMENT_SHADER, "data/shaders/shader.fs", options));
+  }
+  double stageTime = millisecondsSince(start);
+
+  ProgramPipelines pipelines;
+  int failed = 0;
+  for (const Shader& vertexStage : vertexStages)
+    for (const Shader& fragmentStage : fragmentStages)
+      if (pipelines.get(vertexStage, fragmentStage) == 0)
+        failed++;
+  double pipelineTime = millisecondsSince(start);
+
+  std::cout << "pairings: " << vertexCount << " x " << fragmentCount << std::endl;
+  std::cout << "programs:  " << programs.size() << " links, " << programTime << " ms" << std::endl;
+  std::cout << "pipelines: " << vertexStages.size() + fragmentStages.size() << " links, " << pipelines.size()
+            << " pipelines (" << failed << " invalid), " << pipelineTime << " ms (stages " << stageTime << " ms)"
+            << std::endl;
+
+  for (auto& program : programs)
+    glDeleteProgram(program->ID);
+  for (std::vector<Shader>* stages : { &vertexStages, &fragmentStages })
+    for (Shader& stage : *stages)
+      glDeleteProgram(stage.ID);
+
+  glfwTerminate();
+  return 0;
+}
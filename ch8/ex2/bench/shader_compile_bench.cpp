@@ -0,0 +1,91 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "shader.h"
+#include "shader_compiler.h"
+
+// Compares total load time of N programs built synchronously (one Shader at
+// a time) against the ShaderCompiler queue. Each program gets a unique
+// define so neither run is served from the driver's own shader cache.
+//
+//   shader_compile_bench [programs]
+
+namespace
+{
+  using Clock = std::chrono::steady_clock;
+
+  double millisecondsSince(Clock::time_point start)
+  {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  }
+
+  ShaderOptions uniqueOptions(int run, int index)
+  {
+    ShaderOptions options;
+    options.defines.push_back("BENCH_PROGRAM_" + std::to_string(run) + "_" + std::to_string(index));
+    return options;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  int programCount = argc > 1 ? std::atoi(argv[1]) : 64;
+
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+  GLFWwindow* window = glfwCreateWindow(64, 64, "shader_compile_bench", NULL, NULL);
+  if (window == NULL)
+  {
+    std::cout << "Failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    return -1;
+  }
+  glfwMakeContextCurrent(window);
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+  {
+    std::cout << "Failed to initialize GLAD" << std::endl;
+    return -1;
+  }
+
+  // synchronous: every constructor blocks on compile and link status
+  Clock::time_point start = Clock::now();
+  std::vector<std::unique_ptr<Shader>> syncShaders;
+  for (int i = 0; i < programCount; i++)
+    syncShaders.push_back(std::make_unique<Shader>("data/shaders/shader.vs", "data/shaders/shader.fs", uniqueOptions(0, i)));
+  double syncTime = millisecondsSince(start);
+
+  // asynchronous: submit everything, then finish
+  start = Clock::now();
+  ShaderCompiler compiler;
+  for (int i = 0; i < programCount; i++)
+    compiler.submit("data/shaders/shader.vs", "data/shaders/shader.fs", uniqueOptions(1, i));
+  double submitTime = millisecondsSince(start);
+  compiler.finishAll();
+  double asyncTime = millisecondsSince(start);
+
+  std::cout << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+  std::cout << "programs: " << programCount
+            << ", KHR_parallel_shader_compile: " << (compiler.parallel() ? "yes" : "no") << std::endl;
+  std::cout << "sync:  " << syncTime << " ms" << std::endl;
+  std::cout << "async: " << asyncTime << " ms (submit " << submitTime << " ms)" << std::endl;
+
+  for (auto& shader : syncShaders)
+    glDeleteProgram(shader->ID);
+  for (std::size_t i = 0; i < compiler.size(); i++)
+    glDeleteProgram(compiler.get(i).ID);
+
+  glfwTerminate();
+  return 0;
+}
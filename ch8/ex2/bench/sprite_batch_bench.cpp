@@ -0,0 +1,209 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "gl_state.h"
+#include "sampler_cache.h"
+#include "shader.h"
+#include "texture_atlas.h"
+
+// Draws N sprites, each with its own small texture, two ways: one
+// GL_TEXTURE_2D per sprite (a bind and a draw each), and everything packed
+// by TextureAtlas (uvs and layers baked into the vertices, one bind and
+// one draw). Reports texture binds and time per frame.
+//
+//   sprite_batch_bench [sprites] [frames]
+
+namespace
+{
+  using Clock = std::chrono::steady_clock;
+
+  double millisecondsSince(Clock::time_point start)
+  {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  }
+
+  constexpr const char* vertexSource = R"glsl(#version 330 core
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec3 aTexCoord;
+out vec3 texCoord;
+void main()
+{
+    gl_Position = vec4(aPos, 0.0, 1.0);
+    texCoord = aTexCoord;
+}
+)glsl";
+
+  constexpr const char* textureSource = R"glsl(#version 330 core
+in vec3 texCoord;
+out vec4 FragColor;
+uniform sampler2D sprite;
+void main()
+{
+    FragColor = texture(sprite, texCoord.xy);
+}
+)glsl";
+
+  constexpr const char* arraySource = R"glsl(#version 330 core
+in vec3 texCoord;
+out vec4 FragColor;
+uniform sampler2DArray sprites;
+void main()
+{
+    FragColor = texture(sprites, texCoord);
+}
+)glsl";
+
+  // x, y, u, v, layer
+  constexpr int stride = 5;
+}
+
+int main(int argc, char** argv)
+{
+  int spriteCount = argc > 1 ? std::atoi(argv[1]) : 1024;
+  int frameCount = argc > 2 ? std::atoi(argv[2]) : 100;
+
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+  GLFWwindow* window = glfwCreateWindow(256, 256, "sprite_batch_bench", NULL, NULL);
+  if (window == NULL)
+  {
+    std::cout << "Failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    return -1;
+  }
+  glfwMakeContextCurrent(window);
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+  {
+    std::cout << "Failed to initialize GLAD" << std::endl;
+    return -1;
+  }
+
+  {
+    // sprites of a few sizes in a grid, each its own flat color
+    TextureAtlas atlas;
+    std::vector<unsigned int> textures(spriteCount);
+    std::vector<float> vertices;
+    int columns = 32;
+    for (int i = 0; i < spriteCount; i++)
+    {
+      int size = 16 << (i % 4);
+      std::vector<unsigned char> pixels(static_cast<std::size_t>(size) * size * 4);
+      for (std::size_t p = 0; p < pixels.size(); p += 4)
+      {
+        pixels[p] = static_cast<unsigned char>(i * 37);
+        pixels[p + 1] = static_cast<unsigned char>(i * 91);
+        pixels[p + 2] = static_cast<unsigned char>(i * 13);
+        pixels[p + 3] = 255;
+      }
+      atlas.add(pixels.data(), size, size, 4);
+
+      glGenTextures(1, &textures[i]);
+      GLState::bindTexture(0, GL_TEXTURE_2D, textures[i]);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+      glGenerateMipmap(GL_TEXTURE_2D);
+
+      float x = -1.0f + 2.0f * (i % columns) / columns;
+      float y = -1.0f + 2.0f * (i / columns % columns) / columns;
+      float w = 2.0f / columns;
+      float quad[] = { x, y, 0, 0, 0,  x + w, y, 1, 0, 0,  x + w, y + w, 1, 1, 0,
+                       x, y, 0, 0, 0,  x + w, y + w, 1, 1, 0,  x, y + w, 0, 1, 0 };
+      vertices.insert(vertices.end(), std::begin(quad), std::end(quad));
+    }
+    atlas.build();
+    atlas.report();
+
+    std::vector<float> batched = vertices;
+    for (int i = 0; i < spriteCount; i++)
+      atlas.remapTexCoords(i, std::span<float>(batched).subspan(i * 6 * stride, 6 * stride), stride, 2, 4);
+
+    unsigned int VAO[2], VBO[2];
+    glGenVertexArrays(2, VAO);
+    glGenBuffers(2, VBO);
+    const std::vector<float>* data[2] = { &vertices, &batched };
+    for (int i = 0; i < 2; i++)
+    {
+      GLState::bindVertexArray(VAO[i]);
+      GLState::bindBuffer(GL_ARRAY_BUFFER, VBO[i]);
+      glBufferData(GL_ARRAY_BUFFER, data[i]->size() * sizeof(float), data[i]->data(), GL_STATIC_DRAW);
+      glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride * sizeof(float), (void*)0);
+      glEnableVertexAttribArray(0);
+      glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride * sizeof(float), (void*)(2 * sizeof(float)));
+      glEnableVertexAttribArray(1);
+    }
+
+    Shader perTexture = Shader::fromSource(vertexSource, textureSource);
+    Shader packed = Shader::fromSource(vertexSource, arraySource);
+
+    SamplerCache samplers;
+    SamplerDesc clamped;
+    clamped.wrapS = clamped.wrapT = GL_CLAMP_TO_EDGE;
+
+    // separate: a bind and a draw per sprite
+    samplers.bind(0, clamped);
+    GLState::endFrame();
+    perTexture.use();
+    GLState::bindVertexArray(VAO[0]);
+    Clock::time_point start = Clock::now();
+    unsigned int separateBinds = 0;
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+      glClear(GL_COLOR_BUFFER_BIT);
+      for (int i = 0; i < spriteCount; i++)
+      {
+        GLState::bindTexture(0, GL_TEXTURE_2D, textures[i]);
+        glDrawArrays(GL_TRIANGLES, i * 6, 6);
+      }
+      separateBinds += GLState::endFrame().issued;
+    }
+    glFinish();
+    double separateTime = millisecondsSince(start);
+
+    // batched: the atlas holds every sprite, so one bind and one draw
+    packed.use();
+    GLState::bindVertexArray(VAO[1]);
+    start = Clock::now();
+    unsigned int batchedBinds = 0;
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+      glClear(GL_COLOR_BUFFER_BIT);
+      GLState::bindTexture(0, GL_TEXTURE_2D_ARRAY, atlas.placement(0).texture);
+      glDrawArrays(GL_TRIANGLES, 0, spriteCount * 6);
+      batchedBinds += GLState::endFrame().issued;
+    }
+    glFinish();
+    double batchedTime = millisecondsSince(start);
+
+    std::cout << "renderer: " << glGetString(GL_RENDERER) << std::endl;
+    std::cout << "sprites: " << spriteCount << ", frames: " << frameCount << std::endl;
+    std::cout << "separate: " << separateTime / frameCount << " ms/frame, "
+              << separateBinds / frameCount << " state calls/frame" << std::endl;
+    std::cout << "batched:  " << batchedTime / frameCount << " ms/frame, "
+              << batchedBinds / frameCount << " state calls/frame" << std::endl;
+
+    for (unsigned int texture : textures)
+      GLState::forgetTexture(texture);
+    glDeleteTextures(spriteCount, textures.data());
+    for (int i = 0; i < 2; i++)
+    {
+      GLState::forgetVertexArray(VAO[i]);
+      GLState::forgetBuffer(VBO[i]);
+    }
+    glDeleteVertexArrays(2, VAO);
+    glDeleteBuffers(2, VBO);
+    glDeleteProgram(perTexture.ID);
+    glDeleteProgram(packed.ID);
+  }
+
+  glfwTerminate();
+  return 0;
+}
@@ -0,0 +1,44 @@
+# Writes a header with each shader source as a constexpr std::string_view.
+# Run in script mode:
+#   cmake -DOUTPUT=<header> -DSOURCES=<a|b|...> -P embed_shaders.cmake
+# The variable for "data/shaders/shader.vs" is EmbeddedShaders::shaderVs.
+
+string(REPLACE "|" ";" SOURCES "${SOURCES}")
+
+set(content "// generated by cmake/embed_shaders.cmake, do not edit\n")
+string(APPEND content "#ifndef EMBEDDED_SHADERS_H\n#define EMBEDDED_SHADERS_H\n\n")
+string(APPEND content "#include <string_view>\n\nnamespace EmbeddedShaders\n{\n")
+
+foreach(source ${SOURCES})
+  get_filename_component(name "${source}" NAME)
+
+  # shader.vs -> shaderVs
+  string(REGEX REPLACE "[^A-Za-z0-9]+" ";" parts "${name}")
+  set(identifier "")
+  foreach(part ${parts})
+    if(identifier STREQUAL "")
+      set(identifier "${part}")
+    else()
+      string(SUBSTRING "${part}" 0 1 first)
+      string(SUBSTRING "${part}" 1 -1 rest)
+      string(TOUPPER "${first}" first)
+      string(APPEND identifier "${first}${rest}")
+    endif()
+  endforeach()
+
+  file(READ "${source}" code)
+  string(FIND "${code}" ")glsl\"" clash)
+  if(NOT clash EQUAL -1)
+    message(FATAL_ERROR "${source} contains the raw string delimiter )glsl\"")
+  endif()
+
+  string(APPEND content "  // ${name}\n")
+  string(APPEND content "  constexpr std::string_view ${identifier} = R\"glsl(${code})glsl\";\n")
+endforeach()
+
+string(APPEND content "}\n\n#endif\n")
+
+# only touch the header when it changes so dependents don't rebuild
+file(WRITE "${OUTPUT}.tmp" "${content}")
+file(COPY_FILE "${OUTPUT}.tmp" "${OUTPUT}" ONLY_IF_DIFFERENT)
+file(REMOVE "${OUTPUT}.tmp")
@@ -1,4 +1,9 @@
 #version 330 core
+// second texture tiled twice (chapter 7 exercise 2)
+#pragma variant ZOOM_SECOND_TEXTURE
+// blend factor from a uniform instead of a constant (chapter 7 exercise 4)
+#pragma variant MIX_UNIFORM
+
 out vec4 FragColor;
 
 in vec3 ourColor;
@@ -7,8 +12,19 @@ in vec2 texCoord;
 uniform sampler2D texture1;
 uniform sampler2D texture2;
 
+#ifdef MIX_UNIFORM
+uniform float mixValue;
+#else
+const float mixValue = 0.5;
+#endif
+
 void main()
 {
+#ifdef ZOOM_SECOND_TEXTURE
+    vec2 secondCoord = texCoord / 0.5;
+#else
+    vec2 secondCoord = texCoord;
+#endif
     FragColor = mix(texture(texture1, texCoord),
-                    texture(texture2, texCoord), 0.5);
+                    texture(texture2, secondCoord), mixValue);
 }
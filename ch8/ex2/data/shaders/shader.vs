@@ -4,7 +4,10 @@ layout (location = 2) in vec2 aTexCoord;
 
 out vec2 texCoord;
 
-uniform mat4 transform;
+layout (std140) uniform PerDraw
+{
+    mat4 transform;
+};
 
 void main()
 {
@@ -0,0 +1,761 @@
+#include "block_compression.h"
+#include "cpu_features.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace
+{
+  // GL enums, spelled out so the cooker needs no GL headers
+  constexpr std::uint32_t rgbS3tcDxt1 = 0x83F0;
+  constexpr std::uint32_t rgbaS3tcDxt5 = 0x83F3;
+  constexpr std::uint32_t srgbS3tcDxt1 = 0x8C4C;
+  constexpr std::uint32_t srgbAlphaS3tcDxt5 = 0x8C4F;
+  constexpr std::uint32_t rgbaBptc = 0x8E8C;
+  constexpr std::uint32_t srgbAlphaBptc = 0x8E8D;
+
+  constexpr int bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+  // one 4x4 block, channel-major (r, g, b, a) so 8 pixels fill a register
+  struct Block
+  {
+    alignas(32) float c[4][16];
+  };
+
+  // nearest palette entry for every pixel over `channels` channels of
+  // `data`; returns the summed squared error
+  using NearestFn = float (*)(const float* const data[4], const float (*palette)[4], int count, int channels,
+                              std::uint8_t indices[16]);
+
+  float nearestScalar(const float* const data[4], const float (*palette)[4], int count, int channels,
+                      std::uint8_t indices[16])
+  {
+    float total = 0.0f;
+    for (int p = 0; p < 16; p++)
+    {
+      float best = FLT_MAX;
+      int bestIndex = 0;
+      for (int i = 0; i < count; i++)
+      {
+        float d = 0.0f;
+        for (int c = 0; c < channels; c++)
+        {
+          float diff = data[c][p] - palette[i][c];
+          d += diff * diff;
+        }
+        if (d < best)
+        {
+          best = d;
+          bestIndex = i;
+        }
+      }
+      indices[p] = static_cast<std::uint8_t>(bestIndex);
+      total += best;
+    }
+    return total;
+  }
+
+#ifdef CPU_SSE2
+  float nearestSse2(const float* const data[4], const float (*palette)[4], int count, int channels,
+                    std::uint8_t indices[16])
+  {
+    __m128 total = _mm_setzero_ps();
+    for (int quarter = 0; quarter < 16; quarter += 4)
+    {
+      __m128 best = _mm_set1_ps(FLT_MAX);
+      __m128 bestIndex = _mm_setzero_ps();
+      for (int i = 0; i < count; i++)
+      {
+        __m128 d = _mm_setzero_ps();
+        for (int c = 0; c < channels; c++)
+        {
+          __m128 diff = _mm_sub_ps(_mm_loadu_ps(data[c] + quarter), _mm_set1_ps(palette[i][c]));
+          d = _mm_add_ps(d, _mm_mul_ps(diff, diff));
+        }
+        // no blendv before SSE4.1: select with and/andnot
+        __m128 closer = _mm_cmplt_ps(d, best);
+        best = _mm_min_ps(d, best);
+        bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(static_cast<float>(i))),
+                              _mm_andnot_ps(closer, bestIndex));
+      }
+      total = _mm_add_ps(total, best);
+      alignas(16) int lanes[4];
+      _mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_cvttps_epi32(bestIndex));
+      for (int p = 0; p < 4; p++)
+        indices[quarter + p] = static_cast<std::uint8_t>(lanes[p]);
+    }
+    alignas(16) float sums[4];
+    _mm_store_ps(sums, total);
+    return sums[0] + sums[1] + sums[2] + sums[3];
+  }
+#endif
+
+#ifdef CPU_AVX2
+  TARGET_AVX2 float nearestAvx2(const float* const data[4], const float (*palette)[4], int count, int channels,
+                                std::uint8_t indices[16])
+  {
+    __m256 total = _mm256_setzero_ps();
+    for (int half = 0; half < 16; half += 8)
+    {
+      __m256 best = _mm256_set1_ps(FLT_MAX);
+      __m256 bestIndex = _mm256_setzero_ps();
+      for (int i = 0; i < count; i++)
+      {
+        __m256 d = _mm256_setzero_ps();
+        for (int c = 0; c < channels; c++)
+        {
+          __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(data[c] + half), _mm256_set1_ps(palette[i][c]));
+          d = _mm256_add_ps(d, _mm256_mul_ps(diff, diff));
+        }
+        __m256 closer = _mm256_cmp_ps(d, best, _CMP_LT_OQ);
+        best = _mm256_min_ps(d, best);
+        bestIndex = _mm256_blendv_ps(bestIndex, _mm256_set1_ps(static_cast<float>(i)), closer);
+      }
+      total = _mm256_add_ps(total, best);
+      alignas(32) int lanes[8];
+      _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), _mm256_cvttps_epi32(bestIndex));
+      for (int p = 0; p < 8; p++)
+        indices[half + p] = static_cast<std::uint8_t>(lanes[p]);
+    }
+    alignas(32) float sums[8];
+    _mm256_store_ps(sums, total);
+    return sums[0] + sums[1] + sums[2] + sums[3] + sums[4] + sums[5] + sums[6] + sums[7];
+  }
+#endif
+
+  NearestFn selectNearest(bool simd)
+  {
+#ifdef CPU_AVX2
+    if (simd && hasAvx2())
+      return nearestAvx2;
+#endif
+#ifdef CPU_SSE2
+    if (simd)
+      return nearestSse2;
+#endif
+    return nearestScalar;
+  }
+
+  void loadBlock(const unsigned char* pixels, int width, int height, int channels, int bx, int by, Block& block)
+  {
+    for (int y = 0; y < 4; y++)
+    {
+      int sy = std::min(by * 4 + y, height - 1);
+      for (int x = 0; x < 4; x++)
+      {
+        int sx = std::min(bx * 4 + x, width - 1);
+        const unsigned char* p = pixels + (static_cast<std::size_t>(sy) * width + sx) * channels;
+        for (int c = 0; c < 4; c++)
+          block.c[c][y * 4 + x] = c < channels ? p[c] : 255.0f;
+      }
+    }
+  }
+
+  // endpoints from the bounding box, pulled in by 1/16 of its extent
+  void boxEndpoints(const Block& block, int channels, float lo[4], float hi[4])
+  {
+    for (int c = 0; c < channels; c++)
+    {
+      lo[c] = *std::min_element(block.c[c], block.c[c] + 16);
+      hi[c] = *std::max_element(block.c[c], block.c[c] + 16);
+      float inset = (hi[c] - lo[c]) / 16.0f;
+      lo[c] += inset;
+      hi[c] -= inset;
+    }
+  }
+
+  // endpoints near the extremes of the block along its principal axis
+  void axisEndpoints(const Block& block, int channels, float lo[4], float hi[4])
+  {
+    float mean[4] = {};
+    for (int c = 0; c < channels; c++)
+    {
+      for (int p = 0; p < 16; p++)
+        mean[c] += block.c[c][p];
+      mean[c] /= 16.0f;
+    }
+
+    float covariance[4][4] = {};
+    for (int p = 0; p < 16; p++)
+      for (int i = 0; i < channels; i++)
+        for (int j = i; j < channels; j++)
+          covariance[i][j] += (block.c[i][p] - mean[i]) * (block.c[j][p] - mean[j]);
+    for (int i = 0; i < channels; i++)
+      for (int j = 0; j < i; j++)
+        covariance[i][j] = covariance[j][i];
+
+    // power iteration, starting from the bounding box diagonal
+    float axis[4];
+    boxEndpoints(block, channels, lo, hi);
+    for (int c = 0; c < channels; c++)
+      axis[c] = hi[c] - lo[c] + 1.0f;
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+      float next[4] = {};
+      float length = 0.0f;
+      for (int i = 0; i < channels; i++)
+      {
+        for (int j = 0; j < channels; j++)
+          next[i] += covariance[i][j] * axis[j];
+        length = std::max(length, std::fabs(next[i]));
+      }
+      // a flat block has no axis: keep the box
+      if (length < 1e-6f)
+        return;
+      for (int c = 0; c < channels; c++)
+        axis[c] = next[c] / length;
+    }
+
+    float norm = 0.0f;
+    for (int c = 0; c < channels; c++)
+      norm += axis[c] * axis[c];
+    float tMin = FLT_MAX, tMax = -FLT_MAX;
+    for (int p = 0; p < 16; p++)
+    {
+      float t = 0.0f;
+      for (int c = 0; c < channels; c++)
+        t += (block.c[c][p] - mean[c]) * axis[c];
+      tMin = std::min(tMin, t / norm);
+      tMax = std::max(tMax, t / norm);
+    }
+    // the same inset as the box: extremes waste palette entries on outliers
+    float inset = (tMax - tMin) / 16.0f;
+    tMin += inset;
+    tMax -= inset;
+    for (int c = 0; c < channels; c++)
+    {
+      lo[c] = std::clamp(mean[c] + axis[c] * tMin, 0.0f, 255.0f);
+      hi[c] = std::clamp(mean[c] + axis[c] * tMax, 0.0f, 255.0f);
+    }
+  }
+
+  // endpoints minimizing the squared error for fixed interpolation weights
+  // (weight 0 is all lo, 1 all hi); false if the system is singular
+  bool leastSquaresEndpoints(const float* const data[4], int channels, const float weights[16], float lo[4], float hi[4])
+  {
+    float a = 0.0f, b = 0.0f, c = 0.0f;
+    float x[4] = {}, y[4] = {};
+    for (int p = 0; p < 16; p++)
+    {
+      float w = weights[p];
+      a += (1.0f - w) * (1.0f - w);
+      b += (1.0f - w) * w;
+      c += w * w;
+      for (int ch = 0; ch < channels; ch++)
+      {
+        x[ch] += (1.0f - w) * data[ch][p];
+        y[ch] += w * data[ch][p];
+      }
+    }
+    float determinant = a * c - b * b;
+    if (std::fabs(determinant) < 1e-6f)
+      return false;
+    for (int ch = 0; ch < channels; ch++)
+    {
+      lo[ch] = std::clamp((c * x[ch] - b * y[ch]) / determinant, 0.0f, 255.0f);
+      hi[ch] = std::clamp((a * y[ch] - b * x[ch]) / determinant, 0.0f, 255.0f);
+    }
+    return true;
+  }
+
+  std::uint16_t pack565(const float color[4])
+  {
+    int r = static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f);
+    int g = static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f);
+    int b = static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f);
+    return static_cast<std::uint16_t>(r << 11 | g << 5 | b);
+  }
+
+  void unpack565(std::uint16_t value, int color[3])
+  {
+    int r = value >> 11 & 31, g = value >> 5 & 63, b = value & 31;
+    color[0] = r << 3 | r >> 2;
+    color[1] = g << 2 | g >> 4;
+    color[2] = b << 3 | b >> 2;
+  }
+
+  void write16(unsigned char* out, std::uint16_t value)
+  {
+    out[0] = static_cast<unsigned char>(value);
+    out[1] = static_cast<unsigned char>(value >> 8);
+  }
+
+  // one BC1 color block from two endpoints, always in 4-color mode
+  float tryColor(const Block& block, std::uint16_t c0, std::uint16_t c1, NearestFn nearest, unsigned char out[8])
+  {
+    // c0 > c1 selects 4 colors; equal endpoints only need index 0
+    if (c0 < c1)
+      std::swap(c0, c1);
+    int e0[3], e1[3];
+    unpack565(c0, e0);
+    unpack565(c1, e1);
+    float palette[4][4] = {};
+    for (int c = 0; c < 3; c++)
+    {
+      palette[0][c] = static_cast<float>(e0[c]);
+      palette[1][c] = static_cast<float>(e1[c]);
+      palette[2][c] = static_cast<float>((2 * e0[c] + e1[c]) / 3);
+      palette[3][c] = static_cast<float>((e0[c] + 2 * e1[c]) / 3);
+    }
+
+    const float* data[4] = { block.c[0], block.c[1], block.c[2], block.c[3] };
+    std::uint8_t indices[16];
+    float error = nearest(data, palette, c0 == c1 ? 1 : 4, 3, indices);
+
+    std::uint32_t bits = 0;
+    for (int p = 0; p < 16; p++)
+      bits |= static_cast<std::uint32_t>(indices[p]) << (p * 2);
+    write16(out, c0);
+    write16(out + 2, c1);
+    std::memcpy(out + 4, &bits, 4);
+    return error;
+  }
+
+  float encodeColor(const Block& block, int quality, NearestFn nearest, unsigned char out[8])
+  {
+    float lo[4], hi[4];
+    if (quality == 0)
+      boxEndpoints(block, 3, lo, hi);
+    else
+      axisEndpoints(block, 3, lo, hi);
+    float error = tryColor(block, pack565(hi), pack565(lo), nearest, out);
+
+    // refit the endpoints to the indices that were picked
+    static const float colorWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    const float* data[4] = { block.c[0], block.c[1], block.c[2], block.c[3] };
+    for (int iteration = 0; quality >= 2 && iteration < 2; iteration++)
+    {
+      std::uint32_t bits;
+      std::memcpy(&bits, out + 4, 4);
+      float weights[16];
+      for (int p = 0; p < 16; p++)
+        weights[p] = colorWeights[bits >> (p * 2) & 3];
+      if (!leastSquaresEndpoints(data, 3, weights, lo, hi))
+        break;
+      unsigned char trial[8];
+      float trialError = tryColor(block, pack565(lo), pack565(hi), nearest, trial);
+      if (trialError >= error)
+        break;
+      error = trialError;
+      std::memcpy(out, trial, 8);
+    }
+    return error;
+  }
+
+  float tryAlpha(const Block& block, int a0, int a1, NearestFn nearest, unsigned char out[8])
+  {
+    // a0 > a1 selects 8 levels
+    if (a0 < a1)
+      std::swap(a0, a1);
+    float palette[8][4] = {};
+    palette[0][0] = static_cast<float>(a0);
+    palette[1][0] = static_cast<float>(a1);
+    for (int k = 2; k < 8; k++)
+      palette[k][0] = static_cast<float>(((8 - k) * a0 + (k - 1) * a1) / 7);
+
+    const float* data[4] = { block.c[3], nullptr, nullptr, nullptr };
+    std::uint8_t indices[16];
+    float error = nearest(data, palette, a0 == a1 ? 1 : 8, 1, indices);
+
+    std::uint64_t bits = 0;
+    for (int p = 0; p < 16; p++)
+      bits |= static_cast<std::uint64_t>(indices[p]) << (p * 3);
+    out[0] = static_cast<unsigned char>(a0);
+    out[1] = static_cast<unsigned char>(a1);
+    for (int i = 0; i < 6; i++)
+      out[2 + i] = static_cast<unsigned char>(bits >> (i * 8));
+    return error;
+  }
+
+  float encodeAlpha(const Block& block, int quality, NearestFn nearest, unsigned char out[8])
+  {
+    const float* alpha = block.c[3];
+    int a0 = static_cast<int>(*std::max_element(alpha, alpha + 16));
+    int a1 = static_cast<int>(*std::min_element(alpha, alpha + 16));
+    float error = tryAlpha(block, a0, a1, nearest, out);
+    if (quality < 2 || a0 == a1)
+      return error;
+
+    std::uint64_t bits = 0;
+    for (int i = 0; i < 6; i++)
+      bits |= static_cast<std::uint64_t>(out[2 + i]) << (i * 8);
+    float weights[16];
+    for (int p = 0; p < 16; p++)
+    {
+      int index = static_cast<int>(bits >> (p * 3) & 7);
+      weights[p] = index == 0 ? 0.0f : index == 1 ? 1.0f : (index - 1) / 7.0f;
+    }
+    const float* data[4] = { alpha, nullptr, nullptr, nullptr };
+    float lo[4], hi[4];
+    if (!leastSquaresEndpoints(data, 1, weights, lo, hi))
+      return error;
+    unsigned char trial[8];
+    float trialError = tryAlpha(block, static_cast<int>(lo[0] + 0.5f), static_cast<int>(hi[0] + 0.5f), nearest, trial);
+    if (trialError < error)
+    {
+      error = trialError;
+      std::memcpy(out, trial, 8);
+    }
+    return error;
+  }
+
+  // BC7 mode 6 endpoint: 7 bits per channel plus a shared low bit
+  struct Endpoint
+  {
+    int value[4];
+    int pBit;
+  };
+
+  Endpoint quantizeEndpoint(const float color[4])
+  {
+    Endpoint best = {};
+    float bestError = FLT_MAX;
+    for (int pBit = 0; pBit < 2; pBit++)
+    {
+      Endpoint candidate = {};
+      candidate.pBit = pBit;
+      float error = 0.0f;
+      for (int c = 0; c < 4; c++)
+      {
+        candidate.value[c] = std::clamp(static_cast<int>((color[c] - pBit) / 2.0f + 0.5f), 0, 127);
+        float diff = static_cast<float>(candidate.value[c] << 1 | pBit) - color[c];
+        error += diff * diff;
+      }
+      if (error < bestError)
+      {
+        bestError = error;
+        best = candidate;
+      }
+    }
+    return best;
+  }
+
+  struct BitWriter
+  {
+    unsigned char* out;
+    int position = 0;
+
+    void write(std::uint32_t value, int bits)
+    {
+      for (int i = 0; i < bits; i++, position++)
+        if (value >> i & 1)
+          out[position / 8] |= static_cast<unsigned char>(1 << (position % 8));
+    }
+  };
+
+  struct BitReader
+  {
+    const unsigned char* in;
+    int position = 0;
+
+    std::uint32_t read(int bits)
+    {
+      std::uint32_t value = 0;
+      for (int i = 0; i < bits; i++, position++)
+        value |= static_cast<std::uint32_t>(in[position / 8] >> (position % 8) & 1) << i;
+      return value;
+    }
+  };
+
+  float tryMode6(const Block& block, Endpoint e0, Endpoint e1, NearestFn nearest, unsigned char out[16])
+  {
+    int c0[4], c1[4];
+    for (int c = 0; c < 4; c++)
+    {
+      c0[c] = e0.value[c] << 1 | e0.pBit;
+      c1[c] = e1.value[c] << 1 | e1.pBit;
+    }
+    float palette[16][4];
+    for (int i = 0; i < 16; i++)
+      for (int c = 0; c < 4; c++)
+        palette[i][c] = static_cast<float>(((64 - bc7Weights[i]) * c0[c] + bc7Weights[i] * c1[c] + 32) >> 6);
+
+    const float* data[4] = { block.c[0], block.c[1], block.c[2], block.c[3] };
+    std::uint8_t indices[16];
+    float error = nearest(data, palette, 16, 4, indices);
+
+    // the first index has an implied high bit of 0
+    if (indices[0] & 8)
+    {
+      std::swap(e0, e1);
+      for (std::uint8_t& index : indices)
+        index = static_cast<std::uint8_t>(15 - index);
+    }
+
+    std::memset(out, 0, 16);
+    BitWriter writer{ out };
+    writer.write(1 << 6, 7);
+    for (int c = 0; c < 4; c++)
+    {
+      writer.write(e0.value[c], 7);
+      writer.write(e1.value[c], 7);
+    }
+    writer.write(e0.pBit, 1);
+    writer.write(e1.pBit, 1);
+    writer.write(indices[0], 3);
+    for (int p = 1; p < 16; p++)
+      writer.write(indices[p], 4);
+    return error;
+  }
+
+  float encodeMode6(const Block& block, int quality, NearestFn nearest, unsigned char out[16])
+  {
+    float lo[4], hi[4];
+    if (quality == 0)
+      boxEndpoints(block, 4, lo, hi);
+    else
+      axisEndpoints(block, 4, lo, hi);
+    float error = tryMode6(block, quantizeEndpoint(lo), quantizeEndpoint(hi), nearest, out);
+
+    const float* data[4] = { block.c[0], block.c[1], block.c[2], block.c[3] };
+    for (int iteration = 0; quality >= 2 && iteration < 2; iteration++)
+    {
+      BitReader reader{ out, 65 };
+      float weights[16];
+      for (int p = 0; p < 16; p++)
+        weights[p] = bc7Weights[reader.read(p == 0 ? 3 : 4)] / 64.0f;
+      if (!leastSquaresEndpoints(data, 4, weights, lo, hi))
+        break;
+      unsigned char trial[16];
+      float trialError = tryMode6(block, quantizeEndpoint(lo), quantizeEndpoint(hi), nearest, trial);
+      if (trialError >= error)
+        break;
+      error = trialError;
+      std::memcpy(out, trial, 16);
+    }
+    return error;
+  }
+
+  void decodeColor(const unsigned char* in, bool threeColorMode, unsigned char rgba[16][4])
+  {
+    std::uint16_t c0 = static_cast<std::uint16_t>(in[0] | in[1] << 8);
+    std::uint16_t c1 = static_cast<std::uint16_t>(in[2] | in[3] << 8);
+    int palette[4][4];
+    unpack565(c0, palette[0]);
+    unpack565(c1, palette[1]);
+    palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+    for (int c = 0; c < 3; c++)
+    {
+      if (c0 > c1 || !threeColorMode)
+      {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+      }
+      else
+      {
+        palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+        palette[3][c] = 0;
+      }
+    }
+    if (c0 <= c1 && threeColorMode)
+      palette[3][3] = 0;
+
+    std::uint32_t bits;
+    std::memcpy(&bits, in + 4, 4);
+    for (int p = 0; p < 16; p++)
+      for (int c = 0; c < 4; c++)
+        rgba[p][c] = static_cast<unsigned char>(palette[bits >> (p * 2) & 3][c]);
+  }
+
+  void decodeAlpha(const unsigned char* in, unsigned char rgba[16][4])
+  {
+    int a0 = in[0], a1 = in[1];
+    int palette[8] = { a0, a1 };
+    for (int k = 2; k < 8; k++)
+    {
+      if (a0 > a1)
+        palette[k] = ((8 - k) * a0 + (k - 1) * a1) / 7;
+      else if (k < 6)
+        palette[k] = ((6 - k) * a0 + (k - 1) * a1) / 5;
+      else
+        palette[k] = k == 6 ? 0 : 255;
+    }
+    std::uint64_t bits = 0;
+    for (int i = 0; i < 6; i++)
+      bits |= static_cast<std::uint64_t>(in[2 + i]) << (i * 8);
+    for (int p = 0; p < 16; p++)
+      rgba[p][3] = static_cast<unsigned char>(palette[bits >> (p * 3) & 7]);
+  }
+
+  // mode 6 only; other modes decode as magenta
+  void decodeMode6(const unsigned char* in, unsigned char rgba[16][4])
+  {
+    BitReader reader{ in };
+    if (reader.read(7) != 1 << 6)
+    {
+      for (int p = 0; p < 16; p++)
+      {
+        rgba[p][0] = rgba[p][2] = rgba[p][3] = 255;
+        rgba[p][1] = 0;
+      }
+      return;
+    }
+    int e[2][4];
+    for (int c = 0; c < 4; c++)
+    {
+      e[0][c] = static_cast<int>(reader.read(7));
+      e[1][c] = static_cast<int>(reader.read(7));
+    }
+    int p0 = static_cast<int>(reader.read(1));
+    int p1 = static_cast<int>(reader.read(1));
+    for (int c = 0; c < 4; c++)
+    {
+      e[0][c] = e[0][c] << 1 | p0;
+      e[1][c] = e[1][c] << 1 | p1;
+    }
+    for (int p = 0; p < 16; p++)
+    {
+      int w = bc7Weights[reader.read(p == 0 ? 3 : 4)];
+      for (int c = 0; c < 4; c++)
+        rgba[p][c] = static_cast<unsigned char>(((64 - w) * e[0][c] + w * e[1][c] + 32) >> 6);
+    }
+  }
+}
+
+std::size_t blockBytes(BlockFormat format)
+{
+  return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+std::size_t compressedSize(BlockFormat format, int width, int height)
+{
+  return static_cast<std::size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+std::uint32_t compressedInternalFormat(BlockFormat format, bool srgb)
+{
+  switch (format)
+  {
+    case BlockFormat::BC1:
+      return srgb ? srgbS3tcDxt1 : rgbS3tcDxt1;
+    case BlockFormat::BC3:
+      return srgb ? srgbAlphaS3tcDxt5 : rgbaS3tcDxt5;
+    case BlockFormat::BC7:
+      return srgb ? srgbAlphaBptc : rgbaBptc;
+  }
+  return 0;
+}
+
+bool blockFormatFromInternalFormat(std::uint32_t internalFormat, BlockFormat& format, bool& srgb)
+{
+  for (BlockFormat candidate : { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC7 })
+  {
+    for (bool candidateSrgb : { false, true })
+    {
+      if (compressedInternalFormat(candidate, candidateSrgb) == internalFormat)
+      {
+        format = candidate;
+        srgb = candidateSrgb;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+const char* blockEncoderPath(const BlockEncoderOptions& options)
+{
+  NearestFn nearest = selectNearest(options.simd);
+#ifdef CPU_AVX2
+  if (nearest == nearestAvx2)
+    return "avx2";
+#endif
+#ifdef CPU_SSE2
+  if (nearest == nearestSse2)
+    return "sse2";
+#endif
+  return "scalar";
+}
+
+std::vector<unsigned char> compressImage(const unsigned char* pixels, int width, int height, int channels,
+                                         const BlockEncoderOptions& options)
+{
+  NearestFn nearest = selectNearest(options.simd);
+  int quality = std::clamp(options.quality, 0, 2);
+  std::size_t stride = blockBytes(options.format);
+  int blocksWide = (width + 3) / 4;
+  int blocksHigh = (height + 3) / 4;
+
+  std::vector<unsigned char> blocks(compressedSize(options.format, width, height));
+  Block block;
+  for (int by = 0; by < blocksHigh; by++)
+  {
+    for (int bx = 0; bx < blocksWide; bx++)
+    {
+      loadBlock(pixels, width, height, channels, bx, by, block);
+      unsigned char* out = &blocks[(static_cast<std::size_t>(by) * blocksWide + bx) * stride];
+      switch (options.format)
+      {
+        case BlockFormat::BC1:
+          encodeColor(block, quality, nearest, out);
+          break;
+        case BlockFormat::BC3:
+          encodeAlpha(block, quality, nearest, out);
+          encodeColor(block, quality, nearest, out + 8);
+          break;
+        case BlockFormat::BC7:
+          encodeMode6(block, quality, nearest, out);
+          break;
+      }
+    }
+  }
+  return blocks;
+}
+
+std::vector<unsigned char> decompressImage(const unsigned char* blocks, int width, int height, BlockFormat format)
+{
+  std::size_t stride = blockBytes(format);
+  int blocksWide = (width + 3) / 4;
+  int blocksHigh = (height + 3) / 4;
+
+  std::vector<unsigned char> pixels(static_cast<std::size_t>(width) * height * 4);
+  unsigned char rgba[16][4];
+  for (int by = 0; by < blocksHigh; by++)
+  {
+    for (int bx = 0; bx < blocksWide; bx++)
+    {
+      const unsigned char* in = blocks + (static_cast<std::size_t>(by) * blocksWide + bx) * stride;
+      switch (format)
+      {
+        case BlockFormat::BC1:
+          decodeColor(in, true, rgba);
+          break;
+        case BlockFormat::BC3:
+          decodeColor(in + 8, false, rgba);
+          decodeAlpha(in, rgba);
+          break;
+        case BlockFormat::BC7:
+          decodeMode6(in, rgba);
+          break;
+      }
+
+      // edge blocks hang over the image
+      for (int y = 0; y < 4 && by * 4 + y < height; y++)
+        for (int x = 0; x < 4 && bx * 4 + x < width; x++)
+          std::memcpy(&pixels[((static_cast<std::size_t>(by) * 4 + y) * width + bx * 4 + x) * 4], rgba[y * 4 + x], 4);
+    }
+  }
+  return pixels;
+}
+
+double psnr(const unsigned char* reference, int referenceChannels, const unsigned char* image, int imageChannels,
+            int width, int height, int channels)
+{
+  double sum = 0.0;
+  std::size_t count = static_cast<std::size_t>(width) * height;
+  for (std::size_t p = 0; p < count; p++)
+  {
+    for (int c = 0; c < channels; c++)
+    {
+      double diff = static_cast<double>(reference[p * referenceChannels + c]) - image[p * imageChannels + c];
+      sum += diff * diff;
+    }
+  }
+  double mse = sum / (static_cast<double>(count) * channels);
+  if (mse == 0.0)
+    return INFINITY;
+  return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
@@ -0,0 +1,57 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CPU encoder and decoder for the 4x4 block formats GL can sample directly:
+//
+//   BC1  RGB, 8 bytes per block (DXT1)
+//   BC3  RGBA, BC1 color plus an 8-level alpha block, 16 bytes (DXT5)
+//   BC7  RGBA, 16 bytes; only mode 6 (one subset, 7777.1 endpoints,
+//        4-bit indices) is written, which suits smooth images but not
+//        blocks with several distinct colors
+//
+// Endpoints come from the block's bounding box (quality 0) or its
+// principal axis (1), refined by least squares against the chosen indices
+// (2). The nearest-palette search runs 8 or 4 pixels at a time with AVX2 or
+// SSE2 when the CPU has them.
+enum class BlockFormat
+{
+  BC1,
+  BC3,
+  BC7
+};
+
+struct BlockEncoderOptions
+{
+  BlockFormat format = BlockFormat::BC1;
+  // 0 fastest .. 2 best
+  int quality = 1;
+  // false forces the scalar path, e.g. to compare against it
+  bool simd = true;
+};
+
+std::size_t blockBytes(BlockFormat format);
+std::size_t compressedSize(BlockFormat format, int width, int height);
+// GL internal format for the blocks (the sRGB variant decodes color to linear)
+std::uint32_t compressedInternalFormat(BlockFormat format, bool srgb);
+// the format and sRGB-ness of a GL internal format; false if not one of ours
+bool blockFormatFromInternalFormat(std::uint32_t internalFormat, BlockFormat& format, bool& srgb);
+// "avx2", "sse2" or "scalar": the index search the encoder will use
+const char* blockEncoderPath(const BlockEncoderOptions& options);
+
+// tightly packed 8-bit pixels with 3 or 4 channels; partial edge blocks
+// repeat the last row/column
+std::vector<unsigned char> compressImage(const unsigned char* pixels, int width, int height, int channels,
+                                         const BlockEncoderOptions& options);
+// back to tightly packed RGBA8
+std::vector<unsigned char> decompressImage(const unsigned char* blocks, int width, int height, BlockFormat format);
+
+// peak signal to noise ratio over the first `channels` channels of two
+// images, in dB (infinite if they are identical)
+double psnr(const unsigned char* reference, int referenceChannels, const unsigned char* image, int imageChannels,
+            int width, int height, int channels);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+// Instruction sets for the SIMD kernels. SSE2 and NEON are what the build
+// targets anyway; AVX2 kernels are marked TARGET_AVX2 so they alone are
+// compiled for it, and only run when hasAvx2() says the CPU has it.
+#if defined(__SSE2__) || defined(_M_X64)
+#define CPU_SSE2 1
+#include <immintrin.h>
+#endif
+
+#if defined(CPU_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define CPU_AVX2 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+inline bool hasAvx2()
+{
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+}
+#endif
+
+#if defined(__ARM_NEON)
+#define CPU_NEON 1
+#include <arm_neon.h>
+#endif
+
+#endif
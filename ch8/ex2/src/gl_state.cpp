@@ -0,0 +1,254 @@
+#include <glad/glad.h>
+
+#include "gl_state.h"
+
+#include <array>
+
+namespace
+{
+  // never a valid object name, so the first call always goes through
+  constexpr unsigned int unknown = 0xFFFFFFFFu;
+
+  constexpr unsigned int maxTextureUnits = 32;
+  constexpr unsigned int maxIndexedBindings = 16;
+
+  // texture targets we track per unit
+  constexpr std::array<GLenum, 4> textureTargets = {
+    GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_3D, GL_TEXTURE_CUBE_MAP
+  };
+
+  // buffer targets with a generic binding point
+  constexpr std::array<GLenum, 7> bufferTargets = {
+    GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_PIXEL_UNPACK_BUFFER,
+    GL_PIXEL_PACK_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER
+  };
+
+  struct Range
+  {
+    unsigned int buffer = unknown;
+    GLintptr offset = 0;
+    GLsizeiptr size = 0;
+  };
+
+  struct State
+  {
+    unsigned int program = unknown;
+    unsigned int programPipeline = unknown;
+    unsigned int vertexArray = unknown;
+    unsigned int activeUnit = unknown;
+    std::array<unsigned int, bufferTargets.size()> buffers;
+    std::array<Range, maxIndexedBindings> uniformRanges;
+    std::array<std::array<unsigned int, textureTargets.size()>, maxTextureUnits> textures;
+    std::array<unsigned int, maxTextureUnits> samplers;
+
+    State()
+    {
+      buffers.fill(unknown);
+      for (auto& unit : textures)
+        unit.fill(unknown);
+      samplers.fill(unknown);
+    }
+  };
+
+  State state;
+  GLState::Stats frame;
+  GLState::Stats total;
+  unsigned int frames = 0;
+
+  int bufferSlot(GLenum target)
+  {
+    for (std::size_t i = 0; i < bufferTargets.size(); i++)
+      if (bufferTargets[i] == target)
+        return static_cast<int>(i);
+    return -1;
+  }
+
+  int textureSlot(GLenum target)
+  {
+    for (std::size_t i = 0; i < textureTargets.size(); i++)
+      if (textureTargets[i] == target)
+        return static_cast<int>(i);
+    return -1;
+  }
+
+  // true if the call has to be issued; updates the shadow value and counters
+  bool changes(unsigned int& current, unsigned int value)
+  {
+    if (current == value)
+    {
+      frame.elided++;
+      return false;
+    }
+    current = value;
+    frame.issued++;
+    return true;
+  }
+}
+
+void GLState::useProgram(unsigned int program)
+{
+  if (changes(state.program, program))
+    glUseProgram(program);
+}
+
+void GLState::bindProgramPipeline(unsigned int pipeline)
+{
+  useProgram(0);
+  if (changes(state.programPipeline, pipeline))
+    glBindProgramPipeline(pipeline);
+}
+
+void GLState::bindVertexArray(unsigned int vertexArray)
+{
+  if (changes(state.vertexArray, vertexArray))
+  {
+    glBindVertexArray(vertexArray);
+    // the element buffer binding belongs to the vertex array
+    state.buffers[bufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = unknown;
+  }
+}
+
+void GLState::bindBuffer(GLenum target, unsigned int buffer)
+{
+  int slot = bufferSlot(target);
+  if (slot < 0)
+  {
+    frame.issued++;
+    glBindBuffer(target, buffer);
+    return;
+  }
+  if (changes(state.buffers[slot], buffer))
+    glBindBuffer(target, buffer);
+}
+
+void GLState::bindBufferRange(GLenum target, unsigned int index, unsigned int buffer, GLintptr offset, GLsizeiptr size)
+{
+  if (target != GL_UNIFORM_BUFFER || index >= maxIndexedBindings)
+  {
+    frame.issued++;
+    glBindBufferRange(target, index, buffer, offset, size);
+    return;
+  }
+
+  Range& range = state.uniformRanges[index];
+  if (range.buffer == buffer && range.offset == offset && range.size == size)
+  {
+    frame.elided++;
+    return;
+  }
+  range = { buffer, offset, size };
+  // glBindBufferRange also sets the generic binding
+  state.buffers[bufferSlot(target)] = buffer;
+  frame.issued++;
+  glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void GLState::bindTexture(unsigned int unit, GLenum target, unsigned int texture)
+{
+  int slot = textureSlot(target);
+  if (unit >= maxTextureUnits || slot < 0)
+  {
+    frame.issued += 2;
+    state.activeUnit = unit;
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(target, texture);
+    return;
+  }
+
+  if (state.textures[unit][slot] == texture)
+  {
+    frame.elided++;
+    return;
+  }
+  if (changes(state.activeUnit, unit))
+    glActiveTexture(GL_TEXTURE0 + unit);
+  state.textures[unit][slot] = texture;
+  frame.issued++;
+  glBindTexture(target, texture);
+}
+
+void GLState::bindSampler(unsigned int unit, unsigned int sampler)
+{
+  if (unit >= maxTextureUnits)
+  {
+    frame.issued++;
+    glBindSampler(unit, sampler);
+    return;
+  }
+  if (changes(state.samplers[unit], sampler))
+    glBindSampler(unit, sampler);
+}
+
+void GLState::forgetProgram(unsigned int program)
+{
+  if (state.program == program)
+    state.program = unknown;
+}
+
+void GLState::forgetProgramPipeline(unsigned int pipeline)
+{
+  if (state.programPipeline == pipeline)
+    state.programPipeline = unknown;
+}
+
+void GLState::forgetVertexArray(unsigned int vertexArray)
+{
+  if (state.vertexArray == vertexArray)
+    state.vertexArray = unknown;
+  state.buffers[bufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = unknown;
+}
+
+void GLState::forgetBuffer(unsigned int buffer)
+{
+  for (unsigned int& bound : state.buffers)
+    if (bound == buffer)
+      bound = unknown;
+  for (Range& range : state.uniformRanges)
+    if (range.buffer == buffer)
+      range = Range();
+}
+
+void GLState::forgetTexture(unsigned int texture)
+{
+  for (auto& unit : state.textures)
+    for (unsigned int& bound : unit)
+      if (bound == texture)
+        bound = unknown;
+}
+
+void GLState::forgetSampler(unsigned int sampler)
+{
+  for (unsigned int& bound : state.samplers)
+    if (bound == sampler)
+      bound = unknown;
+}
+
+void GLState::invalidate()
+{
+  state = State();
+}
+
+GLState::Stats GLState::frameStats()
+{
+  return frame;
+}
+
+GLState::Stats GLState::endFrame()
+{
+  Stats finished = frame;
+  total.issued += frame.issued;
+  total.elided += frame.elided;
+  frames++;
+  frame = Stats();
+  return finished;
+}
+
+GLState::Stats GLState::totalStats()
+{
+  return total;
+}
+
+unsigned int GLState::frameCount()
+{
+  return frames;
+}
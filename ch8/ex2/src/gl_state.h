@@ -0,0 +1,50 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+// Shadow copy of the GL bindings we change every frame. Each call compares
+// against the last value it set and skips the GL call when nothing would
+// change, counting issued and elided calls so the savings can be measured.
+//
+// The cache only knows what went through it. Code that binds with raw GL
+// calls, or deletes a bound object, must call the matching forget*() or
+// invalidate() so a reused object name is not mistaken for a current one.
+class GLState
+{
+  public:
+    struct Stats
+    {
+      unsigned int issued = 0;
+      unsigned int elided = 0;
+    };
+
+    static void useProgram(unsigned int program);
+    // also makes program 0 current, which a pipeline needs to take effect
+    static void bindProgramPipeline(unsigned int pipeline);
+    static void bindVertexArray(unsigned int vertexArray);
+    static void bindBuffer(GLenum target, unsigned int buffer);
+    static void bindBufferRange(GLenum target, unsigned int index, unsigned int buffer, GLintptr offset, GLsizeiptr size);
+    // selects the unit with glActiveTexture only when it has to
+    static void bindTexture(unsigned int unit, GLenum target, unsigned int texture);
+    static void bindSampler(unsigned int unit, unsigned int sampler);
+
+    static void forgetProgram(unsigned int program);
+    static void forgetProgramPipeline(unsigned int pipeline);
+    static void forgetVertexArray(unsigned int vertexArray);
+    static void forgetBuffer(unsigned int buffer);
+    static void forgetTexture(unsigned int texture);
+    static void forgetSampler(unsigned int sampler);
+    // drop everything, e.g. after third-party code touched GL state
+    static void invalidate();
+
+    // counts since the last endFrame()
+    static Stats frameStats();
+    // close the frame: returns its counts and starts new ones
+    static Stats endFrame();
+    // counts over every finished frame
+    static Stats totalStats();
+    static unsigned int frameCount();
+};
+
+#endif
@@ -0,0 +1,113 @@
+#include <glad/glad.h>
+
+#include "gpu_memory.h"
+#include "gl_state.h"
+
+#include <iostream>
+#include <unordered_map>
+#include <utility>
+
+namespace
+{
+  GpuMemory::Stats accounts;
+  // size and class of every buffer created through bufferData()
+  std::unordered_map<unsigned int, std::pair<GpuMemory::Resource, std::size_t>> buffers;
+
+  int index(GpuMemory::Resource resource)
+  {
+    return static_cast<int>(resource);
+  }
+
+  double mebibytes(std::size_t bytes)
+  {
+    return bytes / (1024.0 * 1024.0);
+  }
+}
+
+void GpuMemory::allocate(Resource resource, std::size_t bytes)
+{
+  accounts.bytes[index(resource)] += bytes;
+  accounts.objects[index(resource)]++;
+}
+
+void GpuMemory::release(Resource resource, std::size_t bytes)
+{
+  accounts.bytes[index(resource)] -= bytes;
+  accounts.objects[index(resource)]--;
+}
+
+void GpuMemory::resize(Resource resource, std::size_t from, std::size_t to)
+{
+  accounts.bytes[index(resource)] += to - from;
+}
+
+void GpuMemory::bufferData(Resource resource, GLenum target, unsigned int buffer, GLsizeiptr size, const void* data,
+                           GLenum usage)
+{
+  GLState::bindBuffer(target, buffer);
+  glBufferData(target, size, data, usage);
+
+  auto [it, created] = buffers.try_emplace(buffer, resource, 0);
+  if (!created)
+    release(it->second.first, it->second.second);
+  it->second = { resource, static_cast<std::size_t>(size) };
+  allocate(resource, static_cast<std::size_t>(size));
+}
+
+void GpuMemory::deleteBuffer(unsigned int buffer)
+{
+  auto it = buffers.find(buffer);
+  if (it != buffers.end())
+  {
+    release(it->second.first, it->second.second);
+    buffers.erase(it);
+  }
+  GLState::forgetBuffer(buffer);
+  glDeleteBuffers(1, &buffer);
+}
+
+std::size_t GpuMemory::used(Resource resource)
+{
+  return accounts.bytes[index(resource)];
+}
+
+std::size_t GpuMemory::used()
+{
+  std::size_t total = 0;
+  for (std::size_t bytes : accounts.bytes)
+    total += bytes;
+  return total;
+}
+
+void GpuMemory::setBudget(std::size_t bytes)
+{
+  accounts.budget = bytes;
+}
+
+std::size_t GpuMemory::budget()
+{
+  return accounts.budget;
+}
+
+std::size_t GpuMemory::excess()
+{
+  std::size_t total = used();
+  return accounts.budget > 0 && total > accounts.budget ? total - accounts.budget : 0;
+}
+
+GpuMemory::Stats GpuMemory::stats()
+{
+  return accounts;
+}
+
+void GpuMemory::report()
+{
+  static const char* names[resourceCount] = { "textures", "buffers", "staging" };
+  std::cout << "GPU memory: ";
+  for (int i = 0; i < resourceCount; i++)
+    std::cout << mebibytes(accounts.bytes[i]) << " MiB " << names[i] << " (" << accounts.objects[i] << "), ";
+  std::cout << mebibytes(used()) << " MiB total";
+  if (accounts.budget > 0)
+    std::cout << " of " << mebibytes(accounts.budget) << " MiB budget";
+  std::cout << std::endl;
+}
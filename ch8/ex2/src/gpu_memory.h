@@ -0,0 +1,60 @@
+#ifndef GPU_MEMORY_H
+#define GPU_MEMORY_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Bytes of video memory our own allocations take, by resource class, and
+// an optional budget for them. Like GLState it only knows what goes
+// through it: Texture2D and the atlas report their storage, and buffers
+// are created with bufferData()/deleteBuffer() below. Sizes are what the
+// formats define; driver padding and alignment come on top.
+//
+// Staying under the budget is up to the owners of the memory (see
+// TextureCache::enforceBudget); this class only does the accounting.
+class GpuMemory
+{
+  public:
+    enum class Resource
+    {
+      Texture,
+      Buffer,
+      // pixel unpack buffers used to stream uploads
+      Staging
+    };
+    static constexpr int resourceCount = 3;
+
+    struct Stats
+    {
+      std::size_t bytes[resourceCount] = {};
+      unsigned int objects[resourceCount] = {};
+      std::size_t budget = 0;
+    };
+
+    // an object of `bytes` was created or destroyed
+    static void allocate(Resource resource, std::size_t bytes);
+    static void release(Resource resource, std::size_t bytes);
+    // an existing object grew or shrank, e.g. levels of a texture
+    static void resize(Resource resource, std::size_t from, std::size_t to);
+
+    // glBufferData through GLState, accounted; specifying the same buffer
+    // again (e.g. to orphan it) replaces its old size
+    static void bufferData(Resource resource, GLenum target, unsigned int buffer, GLsizeiptr size, const void* data,
+                           GLenum usage);
+    // glDeleteBuffers, also forgetting it in GLState and the accounts
+    static void deleteBuffer(unsigned int buffer);
+
+    static std::size_t used(Resource resource);
+    static std::size_t used();
+    // 0 means no budget
+    static void setBudget(std::size_t bytes);
+    static std::size_t budget();
+    // bytes over the budget, 0 when within it
+    static std::size_t excess();
+
+    static Stats stats();
+    static void report();
+};
+
+#endif
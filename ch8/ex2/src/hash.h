@@ -0,0 +1,18 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+#include <string_view>
+
+// 64-bit FNV-1a; pass a previous result as hash to continue it
+inline std::uint64_t fnv1a(std::string_view data, std::uint64_t hash = 14695981039346656037ull)
+{
+  for (unsigned char c : data)
+  {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+#endif
@@ -7,12 +7,25 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <ostream>
 
+#include "embedded_shaders.h"
+#include "gl_state.h"
+#include "gpu_memory.h"
+#include "program_cache.h"
+#include "sampler_cache.h"
 #include "shader.h"
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+#include "shader_prewarm.h"
+#include "shader_stage_cache.h"
+#include "shader_variants.h"
+#include "shader_watcher.h"
+#include "texture_cache.h"
+#include "texture_lod.h"
+#include "texture_streamer.h"
+#include "uniform_buffer.h"
+#include "vertex_layout.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
@@ -20,6 +33,14 @@ void processInput(GLFWwindow* window);
 // settings
 const unsigned int SCREEN_WIDTH = 800;
 const unsigned int SCREEN_HEIGHT = 600;
+// video memory for textures and buffers; cooked textures drop their top
+// mips to stay under it
+const std::size_t GPU_MEMORY_BUDGET = 64 << 20;
+// the quad's vertex format; e.g. Color4u8 and UV2h pack a vertex into 20
+// bytes instead of 32 without touching the vertex data or the draws
+using QuadLayout = VertexLayout<Position3f, Color3f, UV2f>;
+static_assert(QuadLayout::has<VertexSemantic::Position> && QuadLayout::has<VertexSemantic::UV>,
+              "shader.vs reads aPos and aTexCoord");
 
 int main()
 {
@@ -28,6 +49,9 @@ int main()
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  // cooked color textures are sRGB, so shading happens in linear space and
+  // the framebuffer encodes the result
+  glfwWindowHint(GLFW_SRGB_CAPABLE, GLFW_TRUE);
 
   // Make GLFW window object
   GLFWwindow* window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "LearnOpenGL", NULL, NULL);
@@ -46,6 +70,7 @@ int main()
     std::cout << "Failed to initialize GLAD" << std::endl;
     return -1;
   }
+  glEnable(GL_FRAMEBUFFER_SRGB);
 
   glm::vec4 vec(1.0f, 0.0f, 0.0f, 1.0f);
   // trans = glm::translate(trans, glm::vec3(1.0f, 1.0f, 0.0f));
@@ -54,174 +79,252 @@ int main()
   // trans = glm::rotate(trans, glm::radians(90.0f), glm::vec3(0.0, 0.0, 1.0));
   // trans = glm::scale(trans, glm::vec3(0.5, 0.5, 0.5));
 
-  Shader shader("data/shaders/shader.vs", "data/shaders/shader.fs");
-
-  // VBO data
-  // Triangle vertex input 
-  float vertices[] = {
-    0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, // top right
-    0.5f, -0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, // bottom right
-    -0.5f, -0.5f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,  // bottom left
-    -0.5f, 0.5f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f  // top left
-  };
-
-  /* Square vertex data
-  float vertices[] = {
-    0.5f, 0.5f, 0.0f,   // top right
-    0.5f, -0.5f, 0.0f,  // bottom right
-    -0.5f, -0.5f, 0.0f, // bottom left
-    -0.5f, 0.5f, 0.0f   // top left
-  }; */
-
-  unsigned int indices[] = {
-    0, 1, 3,  // first triangle
-    1, 2, 3   // second triangle
-  };
-
-  /* float texCoords[] = {
-    0.0f, 0.0f,  // lower-left corner
-    1.0f, 0.0f,  // lower-right corner
-    0.5f, 0.5f   // top-center corner
-  }; */
-
-  // setup vertex data (and buffer(s)) and configure vertex attributes
-  unsigned int VBO, VAO, EBO;
-  glGenVertexArrays(1, &VAO);
-  glGenBuffers(1, &VBO);
-  glGenBuffers(1, &EBO);
-
-  //1. bind vertex array object 
-  glBindVertexArray(VAO);
-  // 2. copy our verticies array in a buffer for OpenGL to use
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-  // 3. then set our vertex attributes pointers
-  // position attribute
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-  glEnableVertexAttribArray(0);
-  // color attribute
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-  glEnableVertexAttribArray(1);
-
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-  glEnableVertexAttribArray(2);
-
-  unsigned int texture1, texture2;
-  glGenTextures(1, &texture1);
-  glBindTexture(GL_TEXTURE_2D, texture1);
-
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-  stbi_set_flip_vertically_on_load(true);
-
-  int width, height, nrChannels;
-  unsigned char *data = stbi_load("data/textures/container.jpg", &width, &height, &nrChannels, 0);
-
-  if (data)
+  // scene objects release their GL resources before the context goes away
   {
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-  }
-  else
-  {
-    std::cout << "Failed to load texture" << std::endl;
-  }
-
-  stbi_image_free(data);
-
-  glGenTextures(1, &texture2);
-  glBindTexture(GL_TEXTURE_2D, texture2);
-
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-  data = stbi_load("data/textures/awesomeface.png", &width, &height, &nrChannels, 0);
-  if (data)
-  {
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-  }
-  else
-  {
-    std::cout << "Failed to load texture" << std::endl;
-  }
-
-  stbi_image_free(data);
-
-  shader.use();
-  glUniform1i(glGetUniformLocation(shader.ID, "texture1"), 0);
-  shader.setInt("texture2", 1);
-
-  // ..:: Drawing code (in render loop) ::..
-  // 4. draw the object
-
-  // render loop
-  while (!glfwWindowShouldClose(window))
-  {
-    processInput(window);
-
-    // rendering command here
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    /* change shader over time
-    float timeValue = glfwGetTime();
-    float greenValue = (std::sin(timeValue) / 2.0f) + 0.5f;
-    int vertexColorLocation = glGetUniformLocation(shaderProgram, "vertexColor");
-    if (vertexColorLocation == -1)
+    // linked programs are cached on disk so a warm start skips compilation
+    ProgramCache programCache("shader_cache");
+    // stages are compiled once and shared by every program that uses them
+    ShaderStageCache stageCache;
+    ShaderOptions shaderOptions;
+    shaderOptions.binaryCache = &programCache;
+    shaderOptions.stageCache = &stageCache;
+    // only the permutation we draw with gets compiled; submit it now and
+    // only wait for it once the textures are loaded
+#ifdef EMBED_SHADERS
+    ShaderVariants shaderVariants =
+      ShaderVariants::fromSource(EmbeddedShaders::shaderVs, EmbeddedShaders::shaderFs, shaderOptions);
+#else
+    ShaderVariants shaderVariants("data/shaders/shader.vs", "data/shaders/shader.fs", shaderOptions);
+#endif
+    ShaderVariants::Key shaderVariant = shaderVariants.key({});
+    shaderVariants.prefetch(shaderVariant);
+
+    // VBO data
+    // Triangle vertex input 
+    QuadLayout::Vertex vertices[] = {
+      { { 0.5f, 0.5f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f } }, // top right
+      { { 0.5f, -0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f } }, // bottom right
+      { { -0.5f, -0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f } },  // bottom left
+      { { -0.5f, 0.5f, 0.0f }, { 1.0f, 1.0f, 0.0f }, { 0.0f, 1.0f } }  // top left
+    };
+
+    /* Square vertex data
+    float vertices[] = {
+      0.5f, 0.5f, 0.0f,   // top right
+      0.5f, -0.5f, 0.0f,  // bottom right
+      -0.5f, -0.5f, 0.0f, // bottom left
+      -0.5f, 0.5f, 0.0f   // top left
+    }; */
+
+    unsigned int indices[] = {
+      0, 1, 3,  // first triangle
+      1, 2, 3   // second triangle
+    };
+
+    /* float texCoords[] = {
+      0.0f, 0.0f,  // lower-left corner
+      1.0f, 0.0f,  // lower-right corner
+      0.5f, 0.5f   // top-center corner
+    }; */
+
+    // setup vertex data (and buffer(s)) and configure vertex attributes
+    unsigned int VBO, VAO, EBO;
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    //1. bind vertex array object 
+    GLState::bindVertexArray(VAO);
+    // 2. copy our verticies array in a buffer for OpenGL to use
+    GpuMemory::bufferData(GpuMemory::Resource::Buffer, GL_ARRAY_BUFFER, VBO, sizeof(vertices), vertices,
+                          GL_STATIC_DRAW);
+
+    GpuMemory::bufferData(GpuMemory::Resource::Buffer, GL_ELEMENT_ARRAY_BUFFER, EBO, sizeof(indices), indices,
+                          GL_STATIC_DRAW);
+
+    // 3. then set our vertex attributes pointers: position, color and uv,
+    // at the offsets QuadLayout works out
+    QuadLayout::setup();
+
+    // textures are shared through the cache: a second material asking for
+    // the same image gets the texture that is already resident. Misses are
+    // decoded on worker threads and uploaded a few per frame, so the first
+    // frames may draw before every texture has arrived
+    TextureStreamer textureStreamer;
+    TextureCache textureCache(&textureStreamer);
+    const std::size_t uploadBudget = 8 << 20;
+    bool texturesReported = false;
+    // cooked by texture_cooker at build time: mapped and uploaded with their
+    // mip chains, no decode and no glGenerateMipmap. Only the levels up to
+    // 64x64 go in now; finer ones stream in as the quads need them
+    textureCache.streamMips(64);
+    TextureCache::Handle container = textureCache.load("data/textures/container.tex");
+    TextureCache::Handle face = textureCache.load("data/textures/awesomeface.tex");
+    if (!container || !face)
     {
-      std::cout << "Could not find uniform in shader" << std::endl;
-      return -1;
+      std::cout << "Failed to load texture" << std::endl;
     }
-    glUseProgram(shaderProgram);
-    glUniform4f(vertexColorLocation, 0.0f, greenValue, 0.0f, 1.0f);
-    */
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture1);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, texture2);
-
-    shader.use();
-
-    glm::mat4 trans = glm::mat4(1.0f);
-    trans = glm::translate(trans, glm::vec3(0.5f, -0.5f, 0.0f));
-    trans = glm::rotate(trans, (float)glfwGetTime(), glm::vec3(0.0f, 0.0f, 1.0f));
+    GpuMemory::setBudget(GPU_MEMORY_BUDGET);
 
-    unsigned int transformLoc = glGetUniformLocation(shader.ID, "transform");
-    glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(trans));
+    // filtering and wrapping are sampler state, shared by both units;
+    // e.g. GL_NEAREST here gives every texture the blocky look at once
+    SamplerCache samplerCache;
+    SamplerDesc textureSampler;
+    textureSampler.minFilter = GL_LINEAR_MIPMAP_LINEAR;
+    textureSampler.magFilter = GL_LINEAR;
 
-    glBindVertexArray(VAO);
-    // glDrawArrays(GL_TRIANGLES, 0, 3);
-    // glDrawArrays(GL_TRIANGLES, 0, 3);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    Shader& shader = shaderVariants.get(shaderVariant);
+    std::cout << "Program cache: " << programCache.hits() << " hits, " << programCache.misses() << " misses" << std::endl;
 
-    trans = glm::mat4(1.0f);
-    trans = glm::translate(trans, glm::vec3(-0.5f, 0.5f, 0.0f));
-    float scaleAmount = static_cast<float>(sin(glfwGetTime()));
-    trans = glm::scale(trans, glm::vec3(scaleAmount, scaleAmount, scaleAmount));
-    glUniformMatrix4fv(transformLoc, 1, GL_FALSE, &trans[0][0]);
+    shader.use();
+    shader.setInt("texture1", 0);
+    shader.setInt("texture2", 1);
+
+    // per-draw data lives in one uniform buffer, one slot per quad
+    UniformBuffer perDraw(shader, "PerDraw", 0, 2);
+    int transformOffset = perDraw.memberOffset("transform");
+
+    // draw once offscreen with the real textures and layout bound, so the
+    // driver's deferred code generation happens now and not in frame one
+    textureCache.bind(0, container);
+    textureCache.bind(1, face);
+    samplerCache.bind(0, textureSampler);
+    samplerCache.bind(1, textureSampler);
+    perDraw.bind(0);
+    ShaderPrewarm prewarm;
+    prewarm.add(shader, VAO);
+    prewarm.run();
+    prewarm.report();
+
+    // rebuild the program whenever its sources are edited
+    ShaderWatcher shaderWatcher;
+#ifndef EMBED_SHADERS
+    ShaderVariants::StageOptions watchOptions = shaderVariants.watchOptions(shaderVariant);
+    shaderWatcher.watch(shader, "data/shaders/shader.vs", "data/shaders/shader.fs", watchOptions.options,
+                        watchOptions.vertexDefines, watchOptions.fragmentDefines);
+#endif
+
+    // both quads sample both textures: tell the cache how fine, from the
+    // size the quad covers on screen. The estimate reads float positions
+    // and uvs, whatever the layout stores
+    float lodVertices[4 * 5];
+    for (int i = 0; i < 4; i++)
+    {
+      auto position = vertices[i].get<VertexSemantic::Position>();
+      auto uv = vertices[i].get<VertexSemantic::UV>();
+      std::copy(position.begin(), position.end(), lodVertices + i * 5);
+      std::copy(uv.begin(), uv.end(), lodVertices + i * 5 + 3);
+    }
+    auto requireMips = [&](const glm::mat4& transform)
+    {
+      int width, height;
+      glfwGetFramebufferSize(window, &width, &height);
+      for (const TextureCache::Handle& texture : { container, face })
+        if (texture)
+          textureCache.require(texture, mipLevelForMesh(transform, glm::vec2(width, height), lodVertices, 5, 0, 3,
+                                                        indices, 6, glm::vec2(texture->width, texture->height)));
+    };
+
+    // ..:: Drawing code (in render loop) ::..
+    // 4. draw the object
+
+    // render loop
+    while (!glfwWindowShouldClose(window))
+    {
+      processInput(window);
+
+      // upload whatever the decode workers have finished
+      textureStreamer.update(uploadBudget);
+      if (!texturesReported && textureStreamer.idle())
+      {
+        textureCache.report();
+        GpuMemory::report();
+        texturesReported = true;
+      }
+      // what is resident changes rarely, so report it only when it does
+      if (textureCache.enforceBudget())
+        GpuMemory::report();
+
+      // swap in edited shaders at the frame boundary
+      if (shaderWatcher.poll())
+      {
+        shader.use();
+        shader.setInt("texture1", 0);
+        shader.setInt("texture2", 1);
+        perDraw.attach(shader);
+      }
+
+      // rendering command here
+      // (0.2, 0.3, 0.3) in sRGB, given linear for the sRGB framebuffer
+      glClearColor(0.0331f, 0.0732f, 0.0732f, 1.0f);
+      glClear(GL_COLOR_BUFFER_BIT);
+
+      /* change shader over time
+      float timeValue = glfwGetTime();
+      float greenValue = (std::sin(timeValue) / 2.0f) + 0.5f;
+      int vertexColorLocation = glGetUniformLocation(shaderProgram, "vertexColor");
+      if (vertexColorLocation == -1)
+      {
+        std::cout << "Could not find uniform in shader" << std::endl;
+        return -1;
+      }
+      glUseProgram(shaderProgram);
+      glUniform4f(vertexColorLocation, 0.0f, greenValue, 0.0f, 1.0f);
+      */
+      // bindings go through the state cache, which skips the ones that
+      // are already current; textures through the texture cache, which
+      // keeps what is drawn resident
+      textureCache.bind(0, container);
+      textureCache.bind(1, face);
+      samplerCache.bind(0, textureSampler);
+      samplerCache.bind(1, textureSampler);
+
+      shader.use();
+
+      glm::mat4 trans = glm::mat4(1.0f);
+      trans = glm::translate(trans, glm::vec3(0.5f, -0.5f, 0.0f));
+      trans = glm::rotate(trans, (float)glfwGetTime(), glm::vec3(0.0f, 0.0f, 1.0f));
+      perDraw.set(0, transformOffset, trans);
+      requireMips(trans);
+
+      trans = glm::mat4(1.0f);
+      trans = glm::translate(trans, glm::vec3(-0.5f, 0.5f, 0.0f));
+      float scaleAmount = static_cast<float>(sin(glfwGetTime()));
+      trans = glm::scale(trans, glm::vec3(scaleAmount, scaleAmount, scaleAmount));
+      perDraw.set(1, transformOffset, trans);
+      requireMips(trans);
+
+      // one upload for every draw this frame
+      perDraw.flush();
+
+      GLState::bindVertexArray(VAO);
+      // glDrawArrays(GL_TRIANGLES, 0, 3);
+      // glDrawArrays(GL_TRIANGLES, 0, 3);
+      perDraw.bind(0);
+      glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+      perDraw.bind(1);
+      glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+      GLState::endFrame();
+
+      // check and call events and swap the buffers
+      glfwSwapBuffers(window);
+      glfwPollEvents();
+    }
 
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    GLState::Stats glCalls = GLState::totalStats();
+    unsigned int frames = std::max(GLState::frameCount(), 1u);
+    std::cout << "GL state calls per frame: " << glCalls.issued / frames << " issued, "
+              << glCalls.elided / frames << " elided" << std::endl;
 
-    // check and call events and swap the buffers
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    // Delete all arrays, buffers, and program
+    GLState::forgetVertexArray(VAO);
+    glDeleteVertexArrays(1, &VAO);
+    GpuMemory::deleteBuffer(VBO);
+    GpuMemory::deleteBuffer(EBO);
   }
 
-  // Delete all arrays, buffers, and program
-  glDeleteVertexArrays(1, &VAO);
-  glDeleteBuffers(1, &VBO);
-  glDeleteBuffers(1, &EBO);
-
   // Terminate GLFW
   glfwTerminate();
 
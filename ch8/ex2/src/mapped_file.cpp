@@ -0,0 +1,58 @@
+#include "mapped_file.h"
+
+#include <fstream>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+void MappedFile::close()
+{
+#ifdef __unix__
+  if (mapped && buffer.empty())
+    munmap(const_cast<void*>(mapped), length);
+#endif
+  buffer.clear();
+  mapped = nullptr;
+  length = 0;
+}
+
+bool MappedFile::open(const std::string& path)
+{
+  close();
+
+#ifdef __unix__
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  struct stat info;
+  if (fd >= 0 && fstat(fd, &info) == 0 && info.st_size > 0)
+  {
+    void* address = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address != MAP_FAILED)
+    {
+      mapped = address;
+      length = static_cast<std::size_t>(info.st_size);
+    }
+  }
+  if (fd >= 0)
+    ::close(fd);
+#else
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (file && file.tellg() > 0)
+  {
+    buffer.resize(static_cast<std::size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    mapped = buffer.data();
+    length = buffer.size();
+  }
+#endif
+  return mapped != nullptr;
+}
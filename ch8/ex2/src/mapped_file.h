@@ -0,0 +1,37 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A whole file, read-only, mapped into memory where the platform allows it
+// (read into a buffer elsewhere). Mapped pages come straight from the page
+// cache: opening costs no copy and no heap, and untouched parts are never
+// read from disk.
+class MappedFile
+{
+  public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // false if the file can't be opened or is empty
+    bool open(const std::string& path);
+    void close();
+
+    const unsigned char* data() const { return static_cast<const unsigned char*>(mapped); }
+    std::size_t size() const { return length; }
+    std::string_view bytes() const { return { static_cast<const char*>(mapped), length }; }
+
+  private:
+    const void* mapped = nullptr;
+    std::size_t length = 0;
+    // without mmap the file is read into memory instead
+    std::vector<unsigned char> buffer;
+};
+
+#endif
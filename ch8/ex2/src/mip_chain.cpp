@@ -0,0 +1,93 @@
+#include "mip_chain.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace
+{
+  // built on first use, so srgbToLinear() is safe from other files' static
+  // initializers
+  const std::array<float, 256>& srgbTable()
+  {
+    static const std::array<float, 256> table = []
+    {
+      std::array<float, 256> result;
+      for (int i = 0; i < 256; i++)
+      {
+        float c = i / 255.0f;
+        result[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+      }
+      return result;
+    }();
+    return table;
+  }
+
+  // alpha is the last channel of gray+alpha and RGBA images
+  bool isAlpha(int channel, int channels)
+  {
+    return (channels == 2 || channels == 4) && channel == channels - 1;
+  }
+
+  MipLevel downsample(const MipLevel& source, int channels, bool srgb)
+  {
+    MipLevel level;
+    level.width = std::max(source.width / 2, 1);
+    level.height = std::max(source.height / 2, 1);
+    level.pixels.resize(static_cast<std::size_t>(level.width) * level.height * channels);
+    const std::array<float, 256>& table = srgbTable();
+
+    for (int y = 0; y < level.height; y++)
+    {
+      // a side of 1 has no second row/column to average with
+      int y0 = std::min(y * 2, source.height - 1);
+      int y1 = std::min(y * 2 + 1, source.height - 1);
+      for (int x = 0; x < level.width; x++)
+      {
+        int x0 = std::min(x * 2, source.width - 1);
+        int x1 = std::min(x * 2 + 1, source.width - 1);
+        const unsigned char* p[4] = {
+          &source.pixels[(static_cast<std::size_t>(y0) * source.width + x0) * channels],
+          &source.pixels[(static_cast<std::size_t>(y0) * source.width + x1) * channels],
+          &source.pixels[(static_cast<std::size_t>(y1) * source.width + x0) * channels],
+          &source.pixels[(static_cast<std::size_t>(y1) * source.width + x1) * channels]
+        };
+        unsigned char* out = &level.pixels[(static_cast<std::size_t>(y) * level.width + x) * channels];
+        for (int c = 0; c < channels; c++)
+        {
+          if (srgb && !isAlpha(c, channels))
+          {
+            float sum = table[p[0][c]] + table[p[1][c]] + table[p[2][c]] + table[p[3][c]];
+            out[c] = linearToSrgb(sum * 0.25f);
+          }
+          else
+          {
+            out[c] = static_cast<unsigned char>((p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) / 4);
+          }
+        }
+      }
+    }
+    return level;
+  }
+}
+
+float srgbToLinear(unsigned char value)
+{
+  return srgbTable()[value];
+}
+
+unsigned char linearToSrgb(float value)
+{
+  value = std::clamp(value, 0.0f, 1.0f);
+  float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+  return static_cast<unsigned char>(c * 255.0f + 0.5f);
+}
+
+std::vector<MipLevel> buildMipChain(const unsigned char* pixels, int width, int height, int channels, bool srgb)
+{
+  std::vector<MipLevel> chain;
+  chain.push_back({ width, height, std::vector<unsigned char>(pixels, pixels + static_cast<std::size_t>(width) * height * channels) });
+  while (chain.back().width > 1 || chain.back().height > 1)
+    chain.push_back(downsample(chain.back(), channels, srgb));
+  return chain;
+}
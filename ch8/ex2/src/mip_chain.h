@@ -0,0 +1,24 @@
+#ifndef MIP_CHAIN_H
+#define MIP_CHAIN_H
+
+#include <vector>
+
+struct MipLevel
+{
+  int width;
+  int height;
+  // tightly packed rows
+  std::vector<unsigned char> pixels;
+};
+
+// The full mip chain of an 8-bit image down to 1x1, level 0 being a copy of
+// the input. Each level is a 2x2 box filter of the one above. For sRGB
+// images the color channels are averaged in linear light and encoded
+// again, which keeps mips from darkening; alpha is always linear.
+std::vector<MipLevel> buildMipChain(const unsigned char* pixels, int width, int height, int channels, bool srgb);
+
+// single sRGB <-> linear conversions used by the filter
+float srgbToLinear(unsigned char value);
+unsigned char linearToSrgb(float value);
+
+#endif
@@ -0,0 +1,471 @@
+#include "mip_generator.h"
+#include "cpu_features.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace
+{
+  // a level in linear light, 4 floats per texel whatever the channel count
+  struct Texels
+  {
+    int width;
+    int height;
+    std::vector<float> data;
+  };
+
+  // 2:1 along one axis: output texel x reads source texels 2x + offsets[k]
+  struct Filter
+  {
+    int taps;
+    int offsets[8];
+    float weights[8];
+  };
+
+  const Filter boxFilter = { 2, { 0, 1 }, { 0.5f, 0.5f } };
+
+  const Filter kaiserFilter = []
+  {
+    // sinc cut off at the new Nyquist rate, windowed to 4 source texels on
+    // either side of the output texel's center, which lies between 2x and
+    // 2x + 1
+    const double pi = 3.14159265358979323846;
+    const double beta = 4.0;
+    const double radius = 4.0;
+    auto bessel0 = [](double x)
+    {
+      double sum = 1.0, term = 1.0;
+      for (int k = 1; k < 20; k++)
+      {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+      }
+      return sum;
+    };
+
+    Filter filter = { 8, {}, {} };
+    double weights[8], total = 0.0;
+    for (int k = 0; k < 8; k++)
+    {
+      filter.offsets[k] = k - 3;
+      double distance = std::abs(k - 3 - 0.5);
+      double t = distance / 2.0;
+      double sinc = std::sin(pi * t) / (pi * t);
+      double r = distance / radius;
+      weights[k] = sinc * bessel0(beta * std::sqrt(1.0 - r * r)) / bessel0(beta);
+      total += weights[k];
+    }
+    for (int k = 0; k < 8; k++)
+      filter.weights[k] = static_cast<float>(weights[k] / total);
+    return filter;
+  }();
+
+  // byte to float, for linear and for sRGB encoded channels. Built on
+  // first use rather than at static initialization, which could run before
+  // mip_chain.cpp's and read its table unfilled
+  const std::array<std::array<float, 256>, 2>& decodeTables()
+  {
+    static const std::array<std::array<float, 256>, 2> tables = []
+    {
+      std::array<std::array<float, 256>, 2> result;
+      for (int i = 0; i < 256; i++)
+      {
+        result[0][i] = i / 255.0f;
+        result[1][i] = srgbToLinear(static_cast<unsigned char>(i));
+      }
+      return result;
+    }();
+    return tables;
+  }
+
+  // linear to sRGB through a 16-bit table: exact to the byte where pow()
+  // per channel would dominate the whole generator
+  const std::vector<unsigned char>& encodeTable()
+  {
+    static const std::vector<unsigned char> table = []
+    {
+      std::vector<unsigned char> result(65536);
+      for (int i = 0; i < 65536; i++)
+        result[i] = linearToSrgb(i / 65535.0f);
+      return result;
+    }();
+    return table;
+  }
+
+  int alphaChannel(int channels)
+  {
+    return channels == 2 ? 1 : channels == 4 ? 3 : -1;
+  }
+
+  // the source texels output texels [begin, end) read without clamping
+  void interior(const Filter& filter, int inWidth, int outWidth, int& begin, int& end)
+  {
+    begin = std::min((std::max(-filter.offsets[0], 0) + 1) / 2, outWidth);
+    int last = inWidth - 1 - filter.offsets[filter.taps - 1];
+    end = last < 0 ? begin : std::clamp(last / 2 + 1, begin, outWidth);
+  }
+
+  void horizontalTexel(const float* in, int inWidth, int x, const Filter& filter, float* out)
+  {
+    float sum[4] = {};
+    for (int k = 0; k < filter.taps; k++)
+    {
+      const float* texel = in + std::clamp(2 * x + filter.offsets[k], 0, inWidth - 1) * 4;
+      for (int c = 0; c < 4; c++)
+        sum[c] += filter.weights[k] * texel[c];
+    }
+    std::memcpy(out + x * 4, sum, sizeof(sum));
+  }
+
+  void horizontalScalar(const float* in, int inWidth, float* out, int outWidth, const Filter& filter)
+  {
+    for (int x = 0; x < outWidth; x++)
+      horizontalTexel(in, inWidth, x, filter, out);
+  }
+
+  // out[begin] to out[count - 1]; the SIMD kernels finish their rows with it
+  void verticalScalar(const float* const* rows, const Filter& filter, float* out, int begin, int count)
+  {
+    for (int i = begin; i < count; i++)
+    {
+      float sum = 0.0f;
+      for (int k = 0; k < filter.taps; k++)
+        sum += filter.weights[k] * rows[k][i];
+      out[i] = sum;
+    }
+  }
+
+  void verticalScalar(const float* const* rows, const Filter& filter, float* out, int count)
+  {
+    verticalScalar(rows, filter, out, 0, count);
+  }
+
+#ifdef CPU_SSE2
+  void horizontalSse2(const float* in, int inWidth, float* out, int outWidth, const Filter& filter)
+  {
+    int begin, end;
+    interior(filter, inWidth, outWidth, begin, end);
+    for (int x = 0; x < begin; x++)
+      horizontalTexel(in, inWidth, x, filter, out);
+    // a texel is one register
+    for (int x = begin; x < end; x++)
+    {
+      __m128 sum = _mm_setzero_ps();
+      const float* source = in + (2 * x) * 4;
+      for (int k = 0; k < filter.taps; k++)
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(filter.weights[k]),
+                                         _mm_loadu_ps(source + filter.offsets[k] * 4)));
+      _mm_storeu_ps(out + x * 4, sum);
+    }
+    for (int x = end; x < outWidth; x++)
+      horizontalTexel(in, inWidth, x, filter, out);
+  }
+
+  void verticalSse2(const float* const* rows, const Filter& filter, float* out, int count)
+  {
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+      __m128 sum = _mm_setzero_ps();
+      for (int k = 0; k < filter.taps; k++)
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(filter.weights[k]), _mm_loadu_ps(rows[k] + i)));
+      _mm_storeu_ps(out + i, sum);
+    }
+    verticalScalar(rows, filter, out, i, count);
+  }
+#endif
+
+#ifdef CPU_AVX2
+  TARGET_AVX2 void horizontalAvx2(const float* in, int inWidth, float* out, int outWidth, const Filter& filter)
+  {
+    int begin, end;
+    interior(filter, inWidth, outWidth, begin, end);
+    for (int x = 0; x < begin; x++)
+      horizontalTexel(in, inWidth, x, filter, out);
+    // two output texels per register: their sources are 2 texels apart
+    int x = begin;
+    for (; x + 2 <= end; x += 2)
+    {
+      __m256 sum = _mm256_setzero_ps();
+      const float* source = in + (2 * x) * 4;
+      for (int k = 0; k < filter.taps; k++)
+      {
+        const float* texel = source + filter.offsets[k] * 4;
+        __m256 pair = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(texel)), _mm_loadu_ps(texel + 8), 1);
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(filter.weights[k]), pair));
+      }
+      _mm256_storeu_ps(out + x * 4, sum);
+    }
+    for (; x < outWidth; x++)
+      horizontalTexel(in, inWidth, x, filter, out);
+  }
+
+  TARGET_AVX2 void verticalAvx2(const float* const* rows, const Filter& filter, float* out, int count)
+  {
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+      __m256 sum = _mm256_setzero_ps();
+      for (int k = 0; k < filter.taps; k++)
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(filter.weights[k]), _mm256_loadu_ps(rows[k] + i)));
+      _mm256_storeu_ps(out + i, sum);
+    }
+    verticalScalar(rows, filter, out, i, count);
+  }
+#endif
+
+#ifdef CPU_NEON
+  void horizontalNeon(const float* in, int inWidth, float* out, int outWidth, const Filter& filter)
+  {
+    int begin, end;
+    interior(filter, inWidth, outWidth, begin, end);
+    for (int x = 0; x < begin; x++)
+      horizontalTexel(in, inWidth, x, filter, out);
+    for (int x = begin; x < end; x++)
+    {
+      float32x4_t sum = vdupq_n_f32(0.0f);
+      const float* source = in + (2 * x) * 4;
+      for (int k = 0; k < filter.taps; k++)
+        sum = vaddq_f32(sum, vmulq_n_f32(vld1q_f32(source + filter.offsets[k] * 4), filter.weights[k]));
+      vst1q_f32(out + x * 4, sum);
+    }
+    for (int x = end; x < outWidth; x++)
+      horizontalTexel(in, inWidth, x, filter, out);
+  }
+
+  void verticalNeon(const float* const* rows, const Filter& filter, float* out, int count)
+  {
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+      float32x4_t sum = vdupq_n_f32(0.0f);
+      for (int k = 0; k < filter.taps; k++)
+        sum = vaddq_f32(sum, vmulq_n_f32(vld1q_f32(rows[k] + i), filter.weights[k]));
+      vst1q_f32(out + i, sum);
+    }
+    verticalScalar(rows, filter, out, i, count);
+  }
+#endif
+
+  struct Kernels
+  {
+    void (*horizontal)(const float* in, int inWidth, float* out, int outWidth, const Filter& filter);
+    void (*vertical)(const float* const* rows, const Filter& filter, float* out, int count);
+    const char* name;
+  };
+
+  Kernels selectKernels(bool simd)
+  {
+#ifdef CPU_AVX2
+    if (simd && hasAvx2())
+      return { horizontalAvx2, verticalAvx2, "avx2" };
+#endif
+#ifdef CPU_SSE2
+    if (simd)
+      return { horizontalSse2, verticalSse2, "sse2" };
+#endif
+#ifdef CPU_NEON
+    if (simd)
+      return { horizontalNeon, verticalNeon, "neon" };
+#endif
+    return { horizontalScalar, verticalScalar, "scalar" };
+  }
+
+  // row y of the level being reduced, 4 floats per texel; the pointer is
+  // only good until the next call
+  using RowSource = std::function<const float*(int y)>;
+
+  void decodeRow(const unsigned char* pixels, int width, int channels, const MipOptions& options, float* texels)
+  {
+    int alpha = alphaChannel(channels);
+    bool weighted = alpha >= 0 && options.alpha != MipOptions::Alpha::Separate;
+    const float* tables[4];
+    for (int c = 0; c < channels; c++)
+      tables[c] = decodeTables()[options.srgb && c != alpha].data();
+    for (int x = 0; x < width; x++)
+    {
+      const unsigned char* in = pixels + static_cast<std::size_t>(x) * channels;
+      float* out = texels + x * 4;
+      out[0] = out[1] = out[2] = out[3] = 0.0f;
+      for (int c = 0; c < channels; c++)
+        out[c] = tables[c][in[c]];
+      if (weighted)
+        for (int c = 0; c < channels; c++)
+          if (c != alpha)
+            out[c] *= out[alpha];
+    }
+  }
+
+  void encodeRow(const float* texels, int width, int channels, const MipOptions& options, unsigned char* pixels)
+  {
+    int alpha = alphaChannel(channels);
+    bool weighted = alpha >= 0 && options.alpha != MipOptions::Alpha::Separate;
+    bool straighten = weighted && options.alpha == MipOptions::Alpha::Weighted;
+    const unsigned char* encode = options.srgb ? encodeTable().data() : nullptr;
+    for (int x = 0; x < width; x++)
+    {
+      const float* in = texels + x * 4;
+      unsigned char* out = pixels + static_cast<std::size_t>(x) * channels;
+      // ringing of the Kaiser filter can leave the range or put
+      // premultiplied color above alpha
+      float a = alpha >= 0 ? std::clamp(in[alpha], 0.0f, 1.0f) : 1.0f;
+      float scale = straighten ? (a > 0.0f ? 1.0f / a : 0.0f) : 1.0f;
+      float limit = weighted && !straighten ? a : 1.0f;
+      for (int c = 0; c < channels; c++)
+      {
+        if (c == alpha)
+        {
+          out[c] = static_cast<unsigned char>(a * 255.0f + 0.5f);
+          continue;
+        }
+        float value = std::clamp(in[c] * scale, 0.0f, limit);
+        out[c] = encode ? encode[static_cast<int>(value * 65535.0f + 0.5f)]
+                              : static_cast<unsigned char>(value * 255.0f + 0.5f);
+      }
+    }
+  }
+
+  // horizontal pass on each source row as the vertical taps first reach
+  // it, kept in a ring of rows, so only a few filtered rows are ever held
+  Texels downsample(int width, int height, const RowSource& row, const Filter& filter, const Kernels& kernels)
+  {
+    Texels level;
+    level.width = std::max(width / 2, 1);
+    level.height = std::max(height / 2, 1);
+    level.data.resize(static_cast<std::size_t>(level.width) * level.height * 4);
+
+    // output row y reads 2y + offsets; the next one moves on by 2 rows
+    const int ringSize = filter.taps + 2;
+    std::size_t rowFloats = static_cast<std::size_t>(level.width) * 4;
+    std::vector<float> ring(ringSize * rowFloats);
+    std::vector<int> ringRow(ringSize, -1);
+    const float* taps[8];
+    for (int y = 0; y < level.height; y++)
+    {
+      for (int k = 0; k < filter.taps; k++)
+      {
+        int source = std::clamp(2 * y + filter.offsets[k], 0, height - 1);
+        int slot = source % ringSize;
+        if (ringRow[slot] != source)
+        {
+          kernels.horizontal(row(source), width, &ring[slot * rowFloats], level.width, filter);
+          ringRow[slot] = source;
+        }
+        taps[k] = &ring[slot * rowFloats];
+      }
+      kernels.vertical(taps, filter, &level.data[y * rowFloats], static_cast<int>(rowFloats));
+    }
+    return level;
+  }
+
+  MipLevel encode(const Texels& texels, int channels, const MipOptions& options)
+  {
+    MipLevel level{ texels.width, texels.height,
+                    std::vector<unsigned char>(static_cast<std::size_t>(texels.width) * texels.height * channels) };
+    for (int y = 0; y < texels.height; y++)
+      encodeRow(&texels.data[static_cast<std::size_t>(y) * texels.width * 4], texels.width, channels, options,
+                &level.pixels[static_cast<std::size_t>(y) * texels.width * channels]);
+    return level;
+  }
+
+  // walks the chain: the source image first, then each level reduced from
+  // the one before
+  class Reducer
+  {
+    public:
+      Reducer(const unsigned char* sourcePixels, int sourceWidth, int sourceHeight, int sourceChannels,
+              const MipOptions& mipOptions)
+        : pixels(sourcePixels), width(sourceWidth), height(sourceHeight), channels(sourceChannels),
+          options(mipOptions), filter(mipOptions.filter == MipFilter::Kaiser ? kaiserFilter : boxFilter),
+          kernels(selectKernels(mipOptions.simd)), scratch(static_cast<std::size_t>(sourceWidth) * 4)
+      {
+      }
+
+      int levelWidth() const { return reduced ? current.width : width; }
+      int levelHeight() const { return reduced ? current.height : height; }
+
+      void reduce()
+      {
+        RowSource row;
+        if (reduced)
+          row = [this](int y) { return &current.data[static_cast<std::size_t>(y) * current.width * 4]; };
+        else
+          row = [this](int y)
+          {
+            decodeRow(pixels + static_cast<std::size_t>(y) * width * channels, width, channels, options, scratch.data());
+            return scratch.data();
+          };
+        current = downsample(levelWidth(), levelHeight(), row, filter, kernels);
+        reduced = true;
+      }
+
+      MipLevel level() const
+      {
+        if (reduced)
+          return encode(current, channels, options);
+        std::size_t bytes = static_cast<std::size_t>(width) * height * channels;
+        if (options.alpha != MipOptions::Alpha::Premultiplied || alphaChannel(channels) < 0)
+          return { width, height, std::vector<unsigned char>(pixels, pixels + bytes) };
+        // the source itself gets premultiplied
+        MipLevel level{ width, height, std::vector<unsigned char>(bytes) };
+        std::vector<float> texels(static_cast<std::size_t>(width) * 4);
+        for (int y = 0; y < height; y++)
+        {
+          std::size_t offset = static_cast<std::size_t>(y) * width * channels;
+          decodeRow(pixels + offset, width, channels, options, texels.data());
+          encodeRow(texels.data(), width, channels, options, &level.pixels[offset]);
+        }
+        return level;
+      }
+
+    private:
+      const unsigned char* pixels;
+      int width;
+      int height;
+      int channels;
+      const MipOptions& options;
+      const Filter& filter;
+      Kernels kernels;
+      std::vector<float> scratch;
+      Texels current;
+      bool reduced = false;
+  };
+
+  void reduceToFit(Reducer& reducer, int maxSize)
+  {
+    while (maxSize > 0 && std::max(reducer.levelWidth(), reducer.levelHeight()) > maxSize)
+      reducer.reduce();
+  }
+}
+
+std::vector<MipLevel> generateMipChain(const unsigned char* pixels, int width, int height, int channels,
+                                       const MipOptions& options)
+{
+  Reducer reducer(pixels, width, height, channels, options);
+  reduceToFit(reducer, options.maxSize);
+  std::vector<MipLevel> chain;
+  chain.push_back(reducer.level());
+  while (reducer.levelWidth() > 1 || reducer.levelHeight() > 1)
+  {
+    reducer.reduce();
+    chain.push_back(reducer.level());
+  }
+  return chain;
+}
+
+MipLevel downscaleToFit(const unsigned char* pixels, int width, int height, int channels, const MipOptions& options)
+{
+  Reducer reducer(pixels, width, height, channels, options);
+  reduceToFit(reducer, options.maxSize);
+  return reducer.level();
+}
+
+const char* mipGeneratorPath(const MipOptions& options)
+{
+  return selectKernels(options.simd).name;
+}
@@ -0,0 +1,60 @@
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include <vector>
+
+#include "mip_chain.h"
+
+// Mip chains built on the CPU, in place of glGenerateMipmap, whose filter
+// and color space are up to the driver. Levels are filtered in linear
+// light with floats carried from level to level, and only rounded to 8
+// bits on output:
+//
+//   Box     2x2 average, what buildMipChain() computes
+//   Kaiser  8-tap Kaiser-windowed sinc per axis: sharper mips with less
+//           aliasing, at some ringing near hard edges
+//
+// Both run as a horizontal and a vertical pass, 8 floats at a time with
+// AVX2 (picked at runtime), 4 with SSE2 or NEON, or one texel at a time.
+//
+// Alpha can weight the color while filtering. Fully transparent texels of
+// images like awesomeface.png carry whatever color the painter left there,
+// and a plain average bleeds it into the visible edges of the next level.
+enum class MipFilter
+{
+  Box,
+  Kaiser
+};
+
+struct MipOptions
+{
+  MipFilter filter = MipFilter::Box;
+  // color channels are sRGB encoded and filtered after decoding
+  bool srgb = true;
+  enum class Alpha
+  {
+    // filtered like any channel, as buildMipChain() does
+    Separate,
+    // color weighted by alpha while filtering, stored straight
+    Weighted,
+    // stored premultiplied too (level 0 included), for premultiplied blending
+    Premultiplied
+  } alpha = Alpha::Weighted;
+  // larger sources are first reduced to the largest mip level that fits
+  // (0: no limit), so an oversized image never reaches the GPU whole
+  int maxSize = 0;
+  // false runs the one-texel-at-a-time kernels whatever the CPU has
+  bool simd = true;
+};
+
+// tightly packed 8-bit pixels with 1 to 4 channels; alpha is the last
+// channel of 2 and 4 channel images
+std::vector<MipLevel> generateMipChain(const unsigned char* pixels, int width, int height, int channels,
+                                       const MipOptions& options);
+// just the largest level of the chain within options.maxSize, e.g. to
+// clamp an image whose mips the GPU makes anyway
+MipLevel downscaleToFit(const unsigned char* pixels, int width, int height, int channels, const MipOptions& options);
+// "avx2", "sse2", "neon" or "scalar": the filter kernels that will run
+const char* mipGeneratorPath(const MipOptions& options);
+
+#endif
@@ -0,0 +1,157 @@
+#include <glad/glad.h>
+
+#include "program_cache.h"
+#include "hash.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+  std::string_view glString(GLenum name)
+  {
+    const GLubyte* value = glGetString(name);
+    return value ? reinterpret_cast<const char*>(value) : "";
+  }
+
+  struct BinaryHeader
+  {
+    char magic[4];
+    std::uint32_t format;
+    std::uint64_t key;
+    std::uint64_t driverHash;
+    std::uint32_t length;
+    std::uint32_t reserved;
+  };
+
+  constexpr char binaryMagic[4] = { 'G', 'L', 'P', 'B' };
+}
+
+ProgramCache::ProgramCache(std::string cacheDirectory)
+  : directory(std::move(cacheDirectory))
+{
+  driverHash = fnv1a(glString(GL_VENDOR));
+  driverHash = fnv1a(glString(GL_RENDERER), driverHash);
+  driverHash = fnv1a(glString(GL_VERSION), driverHash);
+
+  if (GLAD_GL_ARB_get_program_binary)
+  {
+    int formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    available = formats > 0;
+  }
+
+  if (available)
+  {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+  }
+}
+
+std::uint64_t ProgramCache::key(std::string_view vertexCode, std::string_view fragmentCode) const
+{
+  std::uint64_t hash = fnv1a(vertexCode, driverHash);
+  // separator so moving text between the stages changes the key
+  hash = fnv1a(std::string_view("\0", 1), hash);
+  return fnv1a(fragmentCode, hash);
+}
+
+std::string ProgramCache::pathFor(std::uint64_t key) const
+{
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+  return directory + "/" + name;
+}
+
+bool ProgramCache::load(unsigned int program, std::uint64_t key)
+{
+  if (!available)
+  {
+    missCount++;
+    return false;
+  }
+
+  std::string path = pathFor(key);
+  std::ifstream file(path, std::ios::binary);
+  BinaryHeader header;
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+      || !std::equal(binaryMagic, binaryMagic + 4, header.magic)
+      || header.key != key || header.driverHash != driverHash)
+  {
+    missCount++;
+    return false;
+  }
+
+  // the length comes from disk: a corrupt entry must not size the
+  // allocation, so it has to be exactly what follows the header
+  std::streamoff start = file.tellg();
+  file.seekg(0, std::ios::end);
+  std::streamoff remaining = file.tellg() - start;
+  file.seekg(start);
+  if (!file || remaining != static_cast<std::streamoff>(header.length))
+  {
+    missCount++;
+    return false;
+  }
+
+  std::vector<char> binary(header.length);
+  if (!file.read(binary.data(), binary.size()))
+  {
+    missCount++;
+    return false;
+  }
+
+  glProgramBinary(program, header.format, binary.data(), header.length);
+  int success = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (!success)
+  {
+    // the driver rejected it (e.g. updated without changing its strings)
+    file.close();
+    std::filesystem::remove(path);
+    missCount++;
+    return false;
+  }
+
+  hitCount++;
+  return true;
+}
+
+void ProgramCache::store(unsigned int program, std::uint64_t key)
+{
+  if (!available)
+    return;
+
+  int length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return;
+
+  std::vector<char> binary(length);
+  BinaryHeader header = {};
+  std::copy(binaryMagic, binaryMagic + 4, header.magic);
+  glGetProgramBinary(program, length, NULL, &header.format, binary.data());
+  header.key = key;
+  header.driverHash = driverHash;
+  header.length = static_cast<std::uint32_t>(length);
+
+  // write to a temporary name first so a crash never leaves a torn entry
+  std::string path = pathFor(key);
+  std::string tempPath = path + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(binary.data(), binary.size());
+    if (!file)
+    {
+      std::cout << "ERROR::PROGRAM_CACHE::WRITE_FAILED " << tempPath << std::endl;
+      return;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(tempPath, path, error);
+}
@@ -0,0 +1,41 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Persists linked program binaries on disk so later runs can skip
+// compiling and linking. Entries are keyed by the preprocessed sources and
+// the driver identity, so any edit or driver change is a plain miss.
+class ProgramCache
+{
+  public:
+    // needs a current GL context to read the driver identity
+    explicit ProgramCache(std::string cacheDirectory);
+
+    // false when the driver exposes no program binary formats
+    bool supported() const { return available; }
+
+    std::uint64_t key(std::string_view vertexCode, std::string_view fragmentCode) const;
+    // restore a linked program from disk; false on a miss or a stale binary
+    bool load(unsigned int program, std::uint64_t key);
+    // write the binary of a successfully linked program
+    void store(unsigned int program, std::uint64_t key);
+
+    unsigned int hits() const { return hitCount; }
+    unsigned int misses() const { return missCount; }
+
+  private:
+    std::string directory;
+    std::uint64_t driverHash = 0;
+    bool available = false;
+    unsigned int hitCount = 0;
+    unsigned int missCount = 0;
+
+    std::string pathFor(std::uint64_t key) const;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#include <glad/glad.h>
+
+#include "program_pipelines.h"
+#include "gl_state.h"
+#include "shader.h"
+
+#include <iostream>
+
+ProgramPipelines::~ProgramPipelines()
+{
+  for (const auto& [key, pipeline] : pipelines)
+  {
+    GLState::forgetProgramPipeline(pipeline);
+    glDeleteProgramPipelines(1, &pipeline);
+  }
+}
+
+unsigned int ProgramPipelines::get(const Shader& vertexStage, const Shader& fragmentStage)
+{
+  if (!Shader::separateStagesSupported())
+    return 0;
+  if (!vertexStage.isSeparable() || !fragmentStage.isSeparable() || !vertexStage.valid() || !fragmentStage.valid())
+  {
+    std::cout << "ERROR::PROGRAM_PIPELINE::STAGE_NOT_SEPARABLE" << std::endl;
+    return 0;
+  }
+
+  std::uint64_t key = (std::uint64_t)vertexStage.ID << 32 | fragmentStage.ID;
+  auto it = pipelines.find(key);
+  if (it != pipelines.end())
+    return it->second;
+  if (invalid.contains(key))
+    return 0;
+
+  unsigned int pipeline;
+  glGenProgramPipelines(1, &pipeline);
+  glUseProgramStages(pipeline, GL_VERTEX_SHADER_BIT, vertexStage.ID);
+  glUseProgramStages(pipeline, GL_FRAGMENT_SHADER_BIT, fragmentStage.ID);
+
+  // interface mismatches between the stages only show up here
+  int success;
+  glValidateProgramPipeline(pipeline);
+  glGetProgramPipelineiv(pipeline, GL_VALIDATE_STATUS, &success);
+  if (!success)
+  {
+    char infoLog[512];
+    glGetProgramPipelineInfoLog(pipeline, 512, NULL, infoLog);
+    std::cout << "ERROR::PROGRAM_PIPELINE::VALIDATION_FAILED\n" << infoLog << std::endl;
+    glDeleteProgramPipelines(1, &pipeline);
+    invalid.insert(key);
+    return 0;
+  }
+
+  pipelines.emplace(key, pipeline);
+  return pipeline;
+}
+
+void ProgramPipelines::forget(unsigned int program)
+{
+  auto uses = [program](std::uint64_t key) { return key >> 32 == program || (key & 0xffffffffu) == program; };
+  for (auto it = pipelines.begin(); it != pipelines.end();)
+  {
+    if (uses(it->first))
+    {
+      GLState::forgetProgramPipeline(it->second);
+      glDeleteProgramPipelines(1, &it->second);
+      it = pipelines.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+  std::erase_if(invalid, uses);
+}
+
+void ProgramPipelines::bind(const Shader& vertexStage, const Shader& fragmentStage)
+{
+  // the binding call itself is part of the extension
+  if (Shader::separateStagesSupported())
+    GLState::bindProgramPipeline(get(vertexStage, fragmentStage));
+}
@@ -0,0 +1,49 @@
+#ifndef PROGRAM_PIPELINES_H
+#define PROGRAM_PIPELINES_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+class Shader;
+
+// Program pipeline objects built from separable single-stage programs (see
+// Shader::stage). Any vertex stage can be paired with any fragment stage
+// without linking a program per combination: N vertex and M fragment
+// stages take N + M links instead of N x M. Each pairing gets one pipeline
+// object, created on first use and kept until one of its programs is
+// forgotten (e.g. replaced by ShaderWatcher) or destruction.
+//
+// Needs Shader::separateStagesSupported(); without it get() returns 0 and
+// callers keep linking whole programs.
+class ProgramPipelines
+{
+  public:
+    ProgramPipelines() = default;
+    ~ProgramPipelines();
+
+    ProgramPipelines(const ProgramPipelines&) = delete;
+    ProgramPipelines& operator=(const ProgramPipelines&) = delete;
+
+    // pipeline running these two separable programs, 0 if either is not
+    // separable or failed to link, or if the two don't validate together
+    unsigned int get(const Shader& vertexStage, const Shader& fragmentStage);
+    // get() and bind it through GLState
+    void bind(const Shader& vertexStage, const Shader& fragmentStage);
+
+    // delete the pipelines using a program, before the program is deleted
+    // and its name can be handed out again
+    void forget(unsigned int program);
+
+    unsigned int size() const { return static_cast<unsigned int>(pipelines.size()); }
+
+  private:
+    // keyed by both program IDs
+    std::unordered_map<std::uint64_t, unsigned int> pipelines;
+    // pairings that failed validation, so they aren't validated every frame
+    std::unordered_set<std::uint64_t> invalid;
+};
+
+#endif
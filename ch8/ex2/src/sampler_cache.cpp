@@ -0,0 +1,41 @@
+#include <glad/glad.h>
+
+#include "sampler_cache.h"
+#include "gl_state.h"
+
+SamplerCache::~SamplerCache()
+{
+  for (const auto& [desc, sampler] : samplers)
+  {
+    GLState::forgetSampler(sampler);
+    glDeleteSamplers(1, &sampler);
+  }
+}
+
+unsigned int SamplerCache::get(const SamplerDesc& desc)
+{
+  auto it = samplers.find(desc);
+  if (it != samplers.end())
+    return it->second;
+
+  unsigned int sampler;
+  glGenSamplers(1, &sampler);
+  glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, desc.minFilter);
+  glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, desc.magFilter);
+  glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, desc.wrapS);
+  glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, desc.wrapT);
+  glSamplerParameteri(sampler, GL_TEXTURE_WRAP_R, desc.wrapR);
+  glSamplerParameterf(sampler, GL_TEXTURE_MIN_LOD, desc.minLod);
+  glSamplerParameterf(sampler, GL_TEXTURE_MAX_LOD, desc.maxLod);
+  glSamplerParameterf(sampler, GL_TEXTURE_LOD_BIAS, desc.lodBias);
+  glSamplerParameteri(sampler, GL_TEXTURE_COMPARE_MODE, desc.compareMode);
+  glSamplerParameteri(sampler, GL_TEXTURE_COMPARE_FUNC, desc.compareFunc);
+
+  samplers.emplace(desc, sampler);
+  return sampler;
+}
+
+void SamplerCache::bind(unsigned int unit, const SamplerDesc& desc)
+{
+  GLState::bindSampler(unit, get(desc));
+}
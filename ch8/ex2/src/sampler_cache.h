@@ -0,0 +1,52 @@
+#ifndef SAMPLER_CACHE_H
+#define SAMPLER_CACHE_H
+
+#include <glad/glad.h>
+
+#include <compare>
+#include <map>
+
+// Everything a sampler object holds. Textures keep only their images (and
+// their level range); how they are filtered and wrapped comes from the
+// sampler bound to the unit they are drawn from.
+struct SamplerDesc
+{
+  GLenum minFilter = GL_LINEAR_MIPMAP_LINEAR;
+  GLenum magFilter = GL_LINEAR;
+  GLenum wrapS = GL_REPEAT;
+  GLenum wrapT = GL_REPEAT;
+  GLenum wrapR = GL_REPEAT;
+  float minLod = -1000.0f;
+  float maxLod = 1000.0f;
+  float lodBias = 0.0f;
+  // GL_COMPARE_REF_TO_TEXTURE for shadow maps
+  GLenum compareMode = GL_NONE;
+  GLenum compareFunc = GL_LEQUAL;
+
+  auto operator<=>(const SamplerDesc&) const = default;
+};
+
+// One sampler object per distinct SamplerDesc, created on first use and
+// kept until destruction. Binding goes through GLState, so rebinding the
+// sampler a unit already has costs nothing, and changing how every
+// texture is filtered is one bind per unit.
+class SamplerCache
+{
+  public:
+    SamplerCache() = default;
+    ~SamplerCache();
+
+    SamplerCache(const SamplerCache&) = delete;
+    SamplerCache& operator=(const SamplerCache&) = delete;
+
+    unsigned int get(const SamplerDesc& desc);
+    // get() and bind it to a texture unit through GLState
+    void bind(unsigned int unit, const SamplerDesc& desc);
+
+    unsigned int size() const { return static_cast<unsigned int>(samplers.size()); }
+
+  private:
+    std::map<SamplerDesc, unsigned int> samplers;
+};
+
+#endif
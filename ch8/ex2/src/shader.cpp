@@ -1,110 +1,569 @@
 #include <glad/glad.h> 
 
 #include "shader.h"
+#include "gl_state.h"
+#include "program_cache.h"
+#include "shader_stage_cache.h"
 
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <ostream>
 #include <sstream>
 #include <string>
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath)
+namespace
+{
+  // 32-bit components per element of a uniform type the shadow copy
+  // tracks, 0 for the rest
+  int uniformComponents(GLenum type)
+  {
+    switch (type)
+    {
+      case GL_FLOAT: case GL_INT: case GL_UNSIGNED_INT: case GL_BOOL:
+      case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+      case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_2D_ARRAY_SHADOW:
+      case GL_SAMPLER_CUBE_SHADOW: case GL_SAMPLER_BUFFER: case GL_SAMPLER_2D_MULTISAMPLE:
+      case GL_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_2D:
+        return 1;
+      case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_BOOL_VEC2:
+        return 2;
+      case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_BOOL_VEC3:
+        return 3;
+      case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_BOOL_VEC4: case GL_FLOAT_MAT2:
+        return 4;
+      case GL_FLOAT_MAT3:
+        return 9;
+      case GL_FLOAT_MAT4:
+        return 16;
+      default:
+        return 0;
+    }
+  }
+
+  // set with glUniform*i rather than glUniform*f
+  bool uniformInteger(GLenum type)
+  {
+    switch (type)
+    {
+      case GL_FLOAT: case GL_FLOAT_VEC2: case GL_FLOAT_VEC3: case GL_FLOAT_VEC4:
+      case GL_FLOAT_MAT2: case GL_FLOAT_MAT3: case GL_FLOAT_MAT4:
+        return false;
+      default:
+        return true;
+    }
+  }
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const ShaderOptions& options)
+  : Shader(vertexPath, fragmentPath, options, Deferred{})
+{
+  finish();
+}
+
+Shader Shader::fromSource(std::string_view vertexCode, std::string_view fragmentCode, const ShaderOptions& options)
+{
+  Shader shader(injectDefines(std::string(vertexCode), options.defines),
+                injectDefines(std::string(fragmentCode), options.defines), options, DeferredSource{});
+  shader.finish();
+  return shader;
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const ShaderOptions& options, Deferred)
 {
-  // 1. retrieve the vertex/fragment source code from filePath
   std::string vertexCode;
   std::string fragmentCode;
-  std::ifstream vShaderFile;
-  std::ifstream fShaderFile;
-  //ensure ifstream object can throw exceptions:
-  vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-  fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-  try 
-  {
-    // open files
-    vShaderFile.open(vertexPath);
-    fShaderFile.open(fragmentPath);
-    std::stringstream vShaderStream, fShaderStream;
-    // read file's buffer contents into streams
-    vShaderStream << vShaderFile.rdbuf();
-    fShaderStream << fShaderFile.rdbuf();
-    // close file handlers
-    vShaderFile.close();
-    fShaderFile.close();
-    // covert stream into string
-    vertexCode = vShaderStream.str();
-    fragmentCode = fShaderStream.str();
-  }
-  catch (std::ifstream::failure e)
+  // defines can't be applied to a precompiled module. glShaderBinary comes
+  // with ES2 compatibility in the 3.3 loader, so that has to be there too
+  if (options.spirv && options.defines.empty() && GLAD_GL_ARB_gl_spirv && GLAD_GL_ARB_ES2_compatibility)
+  {
+    vertexCode = readSpirv(std::string(vertexPath) + ".spv");
+    fragmentCode = readSpirv(std::string(fragmentPath) + ".spv");
+    spirvStages = !vertexCode.empty() && !fragmentCode.empty();
+  }
+  if (!spirvStages)
+  {
+    vertexCode = injectDefines(readSource(vertexPath), options.defines);
+    fragmentCode = injectDefines(readSource(fragmentPath), options.defines);
+  }
+  submit(vertexCode, fragmentCode, options);
+}
+
+Shader::Shader(const std::string& vertexCode, const std::string& fragmentCode, const ShaderOptions& options,
+               DeferredSource, bool separableProgram)
+  : separable(separableProgram)
+{
+  submit(vertexCode, fragmentCode, options);
+}
+
+Shader Shader::stage(GLenum type, const char* path, const ShaderOptions& options)
+{
+  if (!separateStagesSupported())
+  {
+    std::cout << "ERROR::SHADER::SEPARATE_STAGES_NOT_SUPPORTED " << path << std::endl;
+    return Shader();
+  }
+  std::string code = injectDefines(readSource(path), options.defines);
+  Shader shader(type == GL_VERTEX_SHADER ? code : std::string(),
+                type == GL_FRAGMENT_SHADER ? code : std::string(), options, DeferredSource{}, true);
+  shader.finish();
+  return shader;
+}
+
+bool Shader::separateStagesSupported()
+{
+  // the loader is generated for 3.3, so the 4.1 entry points are only
+  // loaded, whatever the version, when the extension is listed
+  return GLAD_GL_ARB_separate_shader_objects;
+}
+
+std::string Shader::readSource(const char* path)
+{
+  // retrieve the source code from filePath
+  std::ifstream shaderFile;
+  // ensure ifstream object can throw exceptions:
+  shaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+  try
+  {
+    // read straight into the result, sized from the file length
+    shaderFile.open(path, std::ios::binary | std::ios::ate);
+    std::string code(static_cast<std::size_t>(shaderFile.tellg()), '\0');
+    shaderFile.seekg(0);
+    shaderFile.read(code.data(), static_cast<std::streamsize>(code.size()));
+    return code;
+  }
+  catch (const std::ifstream::failure&)
   {
     std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
   }
+  return {};
+}
+
+std::string Shader::readSpirv(const std::string& path)
+{
+  // no error when missing: the build step is optional
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return {};
+  std::stringstream stream;
+  stream << file.rdbuf();
+  std::string module = stream.str();
 
-  const char* vShaderCode = vertexCode.c_str();
-  const char* fShaderCode = fragmentCode.c_str();
+  const std::uint32_t magic = 0x07230203;
+  std::uint32_t first = 0;
+  if (module.size() < sizeof(first) || module.size() % 4 != 0)
+    return {};
+  std::memcpy(&first, module.data(), sizeof(first));
+  return first == magic ? module : std::string();
+}
+
+std::string Shader::injectDefines(const std::string& code, const std::vector<std::string>& defines)
+{
+  if (defines.empty())
+    return code;
+
+  // defines have to follow the #version line
+  std::size_t insertAt = 0;
+  if (code.starts_with("#version"))
+  {
+    insertAt = code.find('\n');
+    insertAt = insertAt == std::string::npos ? code.size() : insertAt + 1;
+  }
+
+  std::string block;
+  for (const std::string& define : defines)
+    block += "#define " + define + "\n";
+
+  std::string result = code;
+  result.insert(insertAt, block);
+  return result;
+}
+
+void Shader::submit(const std::string& vertexCode, const std::string& fragmentCode, const ShaderOptions& options)
+{
+  ID = glCreateProgram();
+  if (separable)
+    glProgramParameteri(ID, GL_PROGRAM_SEPARABLE, GL_TRUE);
+
+  // a cached binary skips compiling and linking entirely
+  if (options.binaryCache)
+  {
+    pendingCache = options.binaryCache;
+    pendingKey = options.binaryCache->key(vertexCode, fragmentCode);
+    if (options.binaryCache->load(ID, pendingKey))
+    {
+      pendingCache = nullptr;
+      finished = true;
+      linked = true;
+      reflectUniforms();
+      return;
+    }
+  }
+
+  // 2. compile shaders; status is only queried in finish() so the driver
+  // can keep working while we do something else
+  sharedStages = options.stageCache != nullptr && !spirvStages;
+  pendingVertex = compileStage(GL_VERTEX_SHADER, vertexCode, options);
+  pendingFragment = compileStage(GL_FRAGMENT_SHADER, fragmentCode, options);
+
+  // shader program
+  if (pendingCache && pendingCache->supported())
+    glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  if (pendingVertex)
+    glAttachShader(ID, pendingVertex);
+  if (pendingFragment)
+    glAttachShader(ID, pendingFragment);
+  glLinkProgram(ID);
+}
+
+unsigned int Shader::compileStage(GLenum type, const std::string& code, const ShaderOptions& options)
+{
+  if (code.empty())
+    return 0;
+
+  unsigned int shader;
+  if (spirvStages)
+  {
+    // specializing replaces the GLSL front end; status is read the same way
+    shader = glCreateShader(type);
+    glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V_ARB, code.data(), (GLsizei)code.size());
+    glSpecializeShaderARB(shader, "main", 0, nullptr, nullptr);
+    return shader;
+  }
+
+  // stages another program already compiled are attached as they are
+  if (options.stageCache)
+    return options.stageCache->get(type, code);
+
+  const char* shaderCode = code.c_str();
+  shader = glCreateShader(type);
+  glShaderSource(shader, 1, &shaderCode, NULL);
+  glCompileShader(shader);
+  return shader;
+}
+
+bool Shader::ready() const
+{
+  if (finished || !GLAD_GL_KHR_parallel_shader_compile)
+    return true;
+
+  int complete = 0;
+  glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &complete);
+  return complete;
+}
+
+void Shader::finish()
+{
+  if (finished)
+    return;
+  finished = true;
 
-  // 2. compile shaders 
-  unsigned int vertex, fragment;
   int success;
   char infoLog[512];
 
-  // vertex shader 
-  vertex = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertex, 1, &vShaderCode, NULL);
-  glCompileShader(vertex);
   // print compile errors if any
-  glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-  if (!success)
+  if (pendingVertex)
+    glGetShaderiv(pendingVertex, GL_COMPILE_STATUS, &success);
+  if (pendingVertex && !success)
   {
-    glGetShaderInfoLog(vertex, 512, NULL, infoLog);
+    glGetShaderInfoLog(pendingVertex, 512, NULL, infoLog);
     std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
   };
 
-  // fragment shader
-  fragment = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragment, 1, &fShaderCode, NULL);
-  glCompileShader(fragment);
-  // print compile errors if any
-  glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-  if (!success)
+  if (pendingFragment)
+    glGetShaderiv(pendingFragment, GL_COMPILE_STATUS, &success);
+  if (pendingFragment && !success)
   {
-    glGetShaderInfoLog(vertex, 512, NULL, infoLog);
+    glGetShaderInfoLog(pendingFragment, 512, NULL, infoLog);
     std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
   };
 
-  // shader program
-  ID = glCreateProgram();
-  glAttachShader(ID, vertex);
-  glAttachShader(ID, fragment);
-  glLinkProgram(ID);
   // print linking errors if any
   glGetProgramiv(ID, GL_LINK_STATUS, &success);
+  linked = success;
   if (!success)
   {
     glGetProgramInfoLog(ID, 512, NULL, infoLog);
     std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
   }
+  else if (pendingCache)
+  {
+    pendingCache->store(ID, pendingKey);
+  }
 
   // delete shaders; they're linked into our program and no longer necessary
-  glDeleteShader(vertex);
-  glDeleteShader(fragment);
+  // (shared ones belong to the stage cache)
+  if (!sharedStages)
+  {
+    // deleting shader 0 is silently ignored
+    glDeleteShader(pendingVertex);
+    glDeleteShader(pendingFragment);
+  }
+  pendingVertex = 0;
+  pendingFragment = 0;
+  pendingCache = nullptr;
+
+  reflectUniforms();
+}
+
+void Shader::reflectUniforms()
+{
+  int count = 0;
+  int maxLength = 0;
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+  reflection = Reflection();
+  std::vector<Uniform>& uniforms = reflection.uniforms;
+  uniforms.reserve(count);
+  std::string name(maxLength, '\0');
+  for (int i = 0; i < count; i++)
+  {
+    int length = 0;
+    int size = 0;
+    GLenum type;
+    glGetActiveUniform(ID, i, maxLength, &length, &size, &type, name.data());
+    std::string uniformName = name.substr(0, length);
+    int location = glGetUniformLocation(ID, uniformName.c_str());
+    // uniforms inside a block have no location
+    if (location == -1)
+      continue;
+
+    // arrays are reported as "name[0]"; make the bare name resolve too
+    std::string baseName = uniformName;
+    if (uniformName.ends_with("[0]"))
+    {
+      baseName = uniformName.substr(0, length - 3);
+      uniforms.push_back({ baseName, location, type, size });
+    }
+    uniforms.push_back({ std::move(uniformName), location, type, size });
+
+    // a shadow slot for every element; their locations need not be
+    // consecutive, so each is looked up
+    int components = uniformComponents(type);
+    if (components == 0)
+      continue;
+    for (int element = 0; element < size; element++)
+    {
+      int elementLocation = location;
+      if (element > 0)
+        elementLocation = glGetUniformLocation(ID, (baseName + "[" + std::to_string(element) + "]").c_str());
+      if (elementLocation < 0)
+        continue;
+      if (elementLocation >= (int)reflection.slots.size())
+        reflection.slots.resize(elementLocation + 1);
+      reflection.slots[elementLocation] = {
+        components, uniformInteger(type), size - element, reflection.known.size(), reflection.shadow.size()
+      };
+      reflection.known.push_back(false);
+      reflection.shadow.resize(reflection.shadow.size() + components);
+    }
+  }
+
+  std::sort(uniforms.begin(), uniforms.end(),
+            [](const Uniform& a, const Uniform& b) { return a.name < b.name; });
+}
+
+int Shader::uniformLocation(std::string_view name) const
+{
+  const std::vector<Uniform>& uniforms = reflection.uniforms;
+  auto it = std::lower_bound(uniforms.begin(), uniforms.end(), name,
+                             [](const Uniform& u, std::string_view n) { return u.name < n; });
+  if (it == uniforms.end() || it->name != name)
+    return -1;
+  return it->location;
+}
+
+bool Shader::unchanged(int location, bool integer, int components, const void* values, std::size_t count) const
+{
+  // GL ignores location -1 and empty arrays as well, without the call; the
+  // vector setters also rely on this before reading values[0]
+  if (location == -1 || count == 0)
+  {
+    skipCount++;
+    return true;
+  }
+
+  // anything the table doesn't match goes through, and GL reports it
+  uploadCount++;
+  if (location < 0 || location >= (int)reflection.slots.size())
+    return false;
+  const Slot& slot = reflection.slots[location];
+  if (slot.components != components || slot.integer != integer || count > (std::size_t)slot.remaining)
+    return false;
+
+  std::uint32_t* shadowed = reflection.shadow.data() + slot.offset;
+  std::size_t bytes = count * components * sizeof(std::uint32_t);
+  bool known = true;
+  for (std::size_t i = 0; i < count; i++)
+    known = known && reflection.known[slot.element + i];
+  if (known && std::memcmp(shadowed, values, bytes) == 0)
+  {
+    uploadCount--;
+    skipCount++;
+    return true;
+  }
+
+  std::memcpy(shadowed, values, bytes);
+  for (std::size_t i = 0; i < count; i++)
+    reflection.known[slot.element + i] = true;
+  return false;
 }
 
 void Shader::use()
 {
-  glUseProgram(ID);
+  GLState::useProgram(ID);
+}
+
+void Shader::setBool(std::string_view name, bool value) const
+{
+  setBool(uniformLocation(name), value);
+}
+
+void Shader::setInt(std::string_view name, int value) const
+{
+  setInt(uniformLocation(name), value);
+}
+
+void Shader::setFloat(std::string_view name, float value) const
+{
+  setFloat(uniformLocation(name), value);
+}
+
+void Shader::setVec2(std::string_view name, const glm::vec2& value) const
+{
+  setVec2(uniformLocation(name), value);
+}
+
+void Shader::setVec3(std::string_view name, const glm::vec3& value) const
+{
+  setVec3(uniformLocation(name), value);
+}
+
+void Shader::setVec4(std::string_view name, const glm::vec4& value) const
+{
+  setVec4(uniformLocation(name), value);
+}
+
+void Shader::setMat3(std::string_view name, const glm::mat3& value) const
+{
+  setMat3(uniformLocation(name), value);
+}
+
+void Shader::setMat4(std::string_view name, const glm::mat4& value) const
+{
+  setMat4(uniformLocation(name), value);
+}
+
+void Shader::setBool(int location, bool value) const
+{
+  setInt(location, (int)value);
+}
+
+void Shader::setInt(int location, int value) const
+{
+  setInt(location, std::span<const int>(&value, 1));
+}
+
+void Shader::setFloat(int location, float value) const
+{
+  setFloat(location, std::span<const float>(&value, 1));
+}
+
+void Shader::setVec2(int location, const glm::vec2& value) const
+{
+  setVec2(location, std::span<const glm::vec2>(&value, 1));
+}
+
+void Shader::setVec3(int location, const glm::vec3& value) const
+{
+  setVec3(location, std::span<const glm::vec3>(&value, 1));
+}
+
+void Shader::setVec4(int location, const glm::vec4& value) const
+{
+  setVec4(location, std::span<const glm::vec4>(&value, 1));
+}
+
+void Shader::setMat3(int location, const glm::mat3& value) const
+{
+  setMat3(location, std::span<const glm::mat3>(&value, 1));
+}
+
+void Shader::setMat4(int location, const glm::mat4& value) const
+{
+  setMat4(location, std::span<const glm::mat4>(&value, 1));
+}
+
+void Shader::setInt(int location, std::span<const int> values) const
+{
+  if (unchanged(location, true, 1, values.data(), values.size()))
+    return;
+  if (separable)
+    glProgramUniform1iv(ID, location, (GLsizei)values.size(), values.data());
+  else
+    glUniform1iv(location, (GLsizei)values.size(), values.data());
+}
+
+void Shader::setFloat(int location, std::span<const float> values) const
+{
+  if (unchanged(location, false, 1, values.data(), values.size()))
+    return;
+  if (separable)
+    glProgramUniform1fv(ID, location, (GLsizei)values.size(), values.data());
+  else
+    glUniform1fv(location, (GLsizei)values.size(), values.data());
+}
+
+void Shader::setVec2(int location, std::span<const glm::vec2> values) const
+{
+  if (unchanged(location, false, 2, values.data(), values.size()))
+    return;
+  if (separable)
+    glProgramUniform2fv(ID, location, (GLsizei)values.size(), glm::value_ptr(values[0]));
+  else
+    glUniform2fv(location, (GLsizei)values.size(), glm::value_ptr(values[0]));
+}
+
+void Shader::setVec3(int location, std::span<const glm::vec3> values) const
+{
+  if (unchanged(location, false, 3, values.data(), values.size()))
+    return;
+  if (separable)
+    glProgramUniform3fv(ID, location, (GLsizei)values.size(), glm::value_ptr(values[0]));
+  else
+    glUniform3fv(location, (GLsizei)values.size(), glm::value_ptr(values[0]));
 }
 
-void Shader::setBool(const std::string &name, bool value) const
+void Shader::setVec4(int location, std::span<const glm::vec4> values) const
 {
-  glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+  if (unchanged(location, false, 4, values.data(), values.size()))
+    return;
+  if (separable)
+    glProgramUniform4fv(ID, location, (GLsizei)values.size(), glm::value_ptr(values[0]));
+  else
+    glUniform4fv(location, (GLsizei)values.size(), glm::value_ptr(values[0]));
 }
 
-void Shader::setInt(const std::string &name, int value) const
+void Shader::setMat3(int location, std::span<const glm::mat3> values) const
 {
-  glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+  if (unchanged(location, false, 9, values.data(), values.size()))
+    return;
+  if (separable)
+    glProgramUniformMatrix3fv(ID, location, (GLsizei)values.size(), GL_FALSE, glm::value_ptr(values[0]));
+  else
+    glUniformMatrix3fv(location, (GLsizei)values.size(), GL_FALSE, glm::value_ptr(values[0]));
 }
 
-void Shader::setFloat(const std::string &name, float value) const
+void Shader::setMat4(int location, std::span<const glm::mat4> values) const
 {
-  glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+  if (unchanged(location, false, 16, values.data(), values.size()))
+    return;
+  if (separable)
+    glProgramUniformMatrix4fv(ID, location, (GLsizei)values.size(), GL_FALSE, glm::value_ptr(values[0]));
+  else
+    glUniformMatrix4fv(location, (GLsizei)values.size(), GL_FALSE, glm::value_ptr(values[0]));
 }
@@ -2,26 +2,182 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 
+#include <cstdint>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
-class Shader 
+class ProgramCache;
+class ShaderStageCache;
+
+struct ShaderOptions
+{
+  // extra "#define" lines injected after the #version line of every stage
+  std::vector<std::string> defines;
+  // optional on-disk program binary cache
+  ProgramCache* binaryCache = nullptr;
+  // optional cache of compiled stages shared between programs
+  ShaderStageCache* stageCache = nullptr;
+  // load "<path>.spv" from the offline build step through GL_ARB_gl_spirv,
+  // falling back to the GLSL source when the extension (or the ES2
+  // compatibility glShaderBinary comes from) or the file is missing
+  // or defines are set. SPIR-V programs have no uniform names, so the
+  // shaders must give their uniforms and blocks explicit locations/bindings
+  bool spirv = false;
+};
+
+class Shader
 {
   public:
-    // the program ID 
+    // the program ID
     unsigned int ID;
 
+    // an active uniform as reported by the driver; size is the array length
+    struct Uniform
+    {
+      std::string name;
+      int location;
+      GLenum type;
+      int size;
+    };
+
     // constructor read and builds the shader
-    Shader(const char* vertexPath, const char* fragmentPath);
+    Shader(const char* vertexPath, const char* fragmentPath, const ShaderOptions& options = {});
+    // builds from sources already in memory (e.g. EmbeddedShaders), no file
+    // access; named so a path string can't be compiled as GLSL by mistake
+    static Shader fromSource(std::string_view vertexCode, std::string_view fragmentCode,
+                             const ShaderOptions& options = {});
+    // a separable program holding one stage (GL_VERTEX_SHADER or
+    // GL_FRAGMENT_SHADER), to be combined with others by ProgramPipelines;
+    // without separateStagesSupported() an invalid Shader with ID 0
+    static Shader stage(GLenum type, const char* path, const ShaderOptions& options = {});
+    // GL 4.1 or GL_ARB_separate_shader_objects: separable programs, program
+    // pipelines and glProgramUniform*
+    static bool separateStagesSupported();
+    // true once the driver has finished compiling and linking (never blocks)
+    bool ready() const;
+    // query build status, report errors and reflect uniforms; blocks if
+    // the driver is still compiling
+    void finish();
+    // false if the last build failed to compile or link
+    bool valid() const { return linked; }
+    bool isSeparable() const { return separable; }
     // use/activate the shader
     void use();
-    // utility uniform functions
-    void setBool(const std::string &name, bool value) const;
-    void setInt(const std::string &name, int value) const;
-    void setFloat(const std::string &name, float value) const;
+    // look up a uniform location once (-1 if the uniform is not active)
+    int uniformLocation(std::string_view name) const;
+    // active uniforms sorted by name; arrays appear as "name[0]" and "name"
+    const std::vector<Uniform>& activeUniforms() const { return reflection.uniforms; }
+
+    // utility uniform functions. Each keeps a copy of the last value it
+    // uploaded and skips the GL call when the new one is identical
+    void setBool(std::string_view name, bool value) const;
+    void setInt(std::string_view name, int value) const;
+    void setFloat(std::string_view name, float value) const;
+    void setVec2(std::string_view name, const glm::vec2& value) const;
+    void setVec3(std::string_view name, const glm::vec3& value) const;
+    void setVec4(std::string_view name, const glm::vec4& value) const;
+    void setMat3(std::string_view name, const glm::mat3& value) const;
+    void setMat4(std::string_view name, const glm::mat4& value) const;
+    // uniform functions taking a location from uniformLocation()
+    void setBool(int location, bool value) const;
+    void setInt(int location, int value) const;
+    void setFloat(int location, float value) const;
+    void setVec2(int location, const glm::vec2& value) const;
+    void setVec3(int location, const glm::vec3& value) const;
+    void setVec4(int location, const glm::vec4& value) const;
+    void setMat3(int location, const glm::mat3& value) const;
+    void setMat4(int location, const glm::mat4& value) const;
+    // arrays, starting at the element the location refers to
+    void setInt(int location, std::span<const int> values) const;
+    void setFloat(int location, std::span<const float> values) const;
+    void setVec2(int location, std::span<const glm::vec2> values) const;
+    void setVec3(int location, std::span<const glm::vec3> values) const;
+    void setVec4(int location, std::span<const glm::vec4> values) const;
+    void setMat3(int location, std::span<const glm::mat3> values) const;
+    void setMat4(int location, std::span<const glm::mat4> values) const;
+
+    // uniform uploads issued and skipped as unchanged
+    unsigned int uniformUploads() const { return uploadCount; }
+    unsigned int uniformSkips() const { return skipCount; }
+
+    // source helpers, safe to call off the render thread
+    static std::string readSource(const char* path);
+    static std::string injectDefines(const std::string& code, const std::vector<std::string>& defines);
+    // contents of a SPIR-V module, empty if missing or not SPIR-V
+    static std::string readSpirv(const std::string& path);
+
+  private:
+    friend class ShaderCompiler;
+    friend class ShaderVariants;
+    friend class ShaderWatcher;
+
+    // tag for the constructor that submits the build without finishing it
+    struct Deferred {};
+    // no program at all, for a stage the driver can't build
+    Shader() : ID(0), finished(true) {}
+    Shader(const char* vertexPath, const char* fragmentPath, const ShaderOptions& options, Deferred);
+    // tag for the deferred constructor taking already preprocessed sources
+    // rather than paths
+    struct DeferredSource {};
+    // an empty stage is left out, which only makes sense for separable
+    // programs
+    Shader(const std::string& vertexCode, const std::string& fragmentCode, const ShaderOptions& options,
+           DeferredSource, bool separableProgram = false);
+
+    // where the last uploaded value of one uniform location lives
+    struct Slot
+    {
+      // 32-bit components per element; 0 if not tracked
+      int components = 0;
+      bool integer = false;
+      // elements from this one to the end of its array
+      int remaining = 0;
+      std::size_t element = 0;
+      std::size_t offset = 0;
+    };
+
+    // filled once after link and replaced together on reload
+    struct Reflection
+    {
+      std::vector<Uniform> uniforms;
+      // indexed by location
+      std::vector<Slot> slots;
+      // per array element: has a value been uploaded yet
+      std::vector<bool> known;
+      std::vector<std::uint32_t> shadow;
+    };
+    // the shadow copy changes in the const setters
+    mutable Reflection reflection;
+    mutable unsigned int uploadCount = 0;
+    mutable unsigned int skipCount = 0;
+
+    // uniforms are set with glProgramUniform* since a pipeline, not
+    // glUseProgram, makes the program current
+    bool separable = false;
+    // stages are SPIR-V modules rather than GLSL source
+    bool spirvStages = false;
+
+    // build state between submit() and finish()
+    bool finished = false;
+    bool linked = false;
+    unsigned int pendingVertex = 0;
+    unsigned int pendingFragment = 0;
+    bool sharedStages = false;
+    ProgramCache* pendingCache = nullptr;
+    std::uint64_t pendingKey = 0;
+
+    void submit(const std::string& vertexCode, const std::string& fragmentCode, const ShaderOptions& options);
+    unsigned int compileStage(GLenum type, const std::string& code, const ShaderOptions& options);
+    void reflectUniforms();
+    // true if the values already are in the program; records them otherwise
+    bool unchanged(int location, bool integer, int components, const void* values, std::size_t count) const;
 };
 
 #endif
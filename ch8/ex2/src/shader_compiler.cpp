@@ -0,0 +1,38 @@
+#include <glad/glad.h>
+
+#include "shader_compiler.h"
+
+ShaderCompiler::ShaderCompiler()
+{
+  // let the driver pick how many compiler threads to use
+  if (GLAD_GL_KHR_parallel_shader_compile)
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+}
+
+ShaderCompiler::Job ShaderCompiler::submit(const char* vertexPath, const char* fragmentPath, const ShaderOptions& options)
+{
+  shaders.push_back(std::unique_ptr<Shader>(new Shader(vertexPath, fragmentPath, options, Shader::Deferred{})));
+  return shaders.size() - 1;
+}
+
+bool ShaderCompiler::ready(Job job) const
+{
+  return shaders[job]->ready();
+}
+
+Shader& ShaderCompiler::get(Job job)
+{
+  Shader& shader = *shaders[job];
+  shader.finish();
+  return shader;
+}
+
+void ShaderCompiler::finishAll()
+{
+  // finish the ones the driver is done with first, then wait on the rest
+  for (auto& shader : shaders)
+    if (shader->ready())
+      shader->finish();
+  for (auto& shader : shaders)
+    shader->finish();
+}
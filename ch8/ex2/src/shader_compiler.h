@@ -0,0 +1,43 @@
+#ifndef SHADER_COMPILER_H
+#define SHADER_COMPILER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "shader.h"
+
+// Queue of program builds that are submitted up front and finished lazily.
+// With KHR_parallel_shader_compile the driver compiles on its own threads
+// while the caller keeps loading other assets; without it the work still
+// overlaps with the driver's internal pipelining because no status query
+// happens until a program is actually needed.
+class ShaderCompiler
+{
+  public:
+    using Job = std::size_t;
+
+    // needs a current GL context
+    ShaderCompiler();
+
+    // true when the driver compiles on background threads
+    bool parallel() const { return GLAD_GL_KHR_parallel_shader_compile; }
+
+    // start compiling and linking; returns a handle for ready()/get()
+    Job submit(const char* vertexPath, const char* fragmentPath, const ShaderOptions& options = {});
+    // non-blocking completion check
+    bool ready(Job job) const;
+    // finish the build (blocking if still compiling) and return the shader
+    Shader& get(Job job);
+    // finish every submitted build
+    void finishAll();
+
+    std::size_t size() const { return shaders.size(); }
+
+  private:
+    std::vector<std::unique_ptr<Shader>> shaders;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include <glad/glad.h>
+
+#include "shader_prewarm.h"
+#include "gl_state.h"
+
+#include <chrono>
+#include <iostream>
+
+ShaderPrewarm::ShaderPrewarm()
+{
+  glGenRenderbuffers(1, &colorBuffer);
+  allocate(glIsEnabled(GL_FRAMEBUFFER_SRGB) ? GL_SRGB8_ALPHA8 : GL_RGBA8);
+
+  int previous = 0;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    std::cout << "ERROR::SHADER_PREWARM::FRAMEBUFFER_INCOMPLETE" << std::endl;
+  glBindFramebuffer(GL_FRAMEBUFFER, previous);
+}
+
+ShaderPrewarm::~ShaderPrewarm()
+{
+  glDeleteFramebuffers(1, &framebuffer);
+  glDeleteRenderbuffers(1, &colorBuffer);
+}
+
+void ShaderPrewarm::allocate(GLenum format)
+{
+  if (format == colorFormat)
+    return;
+  colorFormat = format;
+  glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, format, 1, 1);
+}
+
+void ShaderPrewarm::add(const Shader& shader, unsigned int vertexArray, GLenum primitive, GLenum indexType)
+{
+  entries.push_back({ shader.ID, vertexArray, primitive, indexType });
+}
+
+void ShaderPrewarm::run()
+{
+  if (entries.empty())
+    return;
+
+  int previous = 0;
+  int viewport[4];
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  // the same encoding as the frames' target
+  allocate(glIsEnabled(GL_FRAMEBUFFER_SRGB) ? GL_SRGB8_ALPHA8 : GL_RGBA8);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glViewport(0, 0, 1, 1);
+
+  // earlier work would otherwise be billed to the first program
+  glFinish();
+  for (const Entry& entry : entries)
+  {
+    auto start = std::chrono::steady_clock::now();
+    GLState::useProgram(entry.program);
+    GLState::bindVertexArray(entry.vertexArray);
+    // the element buffer binding is vertex array state
+    int elementBuffer = 0;
+    glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &elementBuffer);
+    if (elementBuffer != 0)
+      glDrawElements(entry.primitive, 3, entry.indexType, 0);
+    else
+      glDrawArrays(entry.primitive, 0, 3);
+    // wait so the time covers code generation, not just queuing the draw
+    glFinish();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    results.push_back({ entry.program, entry.vertexArray, elapsed.count() });
+  }
+  entries.clear();
+
+  glBindFramebuffer(GL_FRAMEBUFFER, previous);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void ShaderPrewarm::report() const
+{
+  double total = 0.0;
+  for (const Timing& timing : results)
+  {
+    std::cout << "Prewarm: program " << timing.program << ", vertex array " << timing.vertexArray << ": "
+              << timing.milliseconds << " ms" << std::endl;
+    total += timing.milliseconds;
+  }
+  std::cout << "Prewarm: " << results.size() << " draws, " << total << " ms" << std::endl;
+}
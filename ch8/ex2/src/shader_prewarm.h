@@ -0,0 +1,66 @@
+#ifndef SHADER_PREWARM_H
+#define SHADER_PREWARM_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+#include "shader.h"
+
+// Load-time draws that make the driver finish code generation before the
+// first real frame. Drivers compile the final program variant on the first
+// draw that uses it with a given vertex layout, so each registered pair is
+// drawn once into a 1x1 offscreen framebuffer and waited on. Some also key
+// the variant on the render target's format and the kind of draw: the
+// target is sRGB while GL_FRAMEBUFFER_SRGB is enabled, and vertex arrays
+// with an element buffer are drawn indexed, as frames draw them.
+//
+// The draw uses whatever textures, buffers and render state are current;
+// run() after those are set up so the warmed variant is the one frames use.
+class ShaderPrewarm
+{
+  public:
+    struct Timing
+    {
+      unsigned int program;
+      unsigned int vertexArray;
+      double milliseconds;
+    };
+
+    ShaderPrewarm();
+    ~ShaderPrewarm();
+
+    ShaderPrewarm(const ShaderPrewarm&) = delete;
+    ShaderPrewarm& operator=(const ShaderPrewarm&) = delete;
+
+    // the vertex array supplies the layout and needs at least 3 vertices,
+    // and 3 indices of indexType if it has an element buffer
+    void add(const Shader& shader, unsigned int vertexArray, GLenum primitive = GL_TRIANGLES,
+             GLenum indexType = GL_UNSIGNED_INT);
+    // draw every pair added since the last run and time each one
+    void run();
+    // print the timings of every run so far
+    void report() const;
+
+    const std::vector<Timing>& timings() const { return results; }
+
+  private:
+    // (re)allocate the color buffer if the format has changed
+    void allocate(GLenum format);
+
+    struct Entry
+    {
+      unsigned int program;
+      unsigned int vertexArray;
+      GLenum primitive;
+      GLenum indexType;
+    };
+
+    unsigned int framebuffer = 0;
+    unsigned int colorBuffer = 0;
+    GLenum colorFormat = 0;
+    std::vector<Entry> entries;
+    std::vector<Timing> results;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#include <glad/glad.h>
+
+#include "shader_stage_cache.h"
+#include "hash.h"
+
+ShaderStageCache::~ShaderStageCache()
+{
+  clear();
+}
+
+unsigned int ShaderStageCache::get(GLenum type, const std::string& code)
+{
+  std::uint64_t key = fnv1a(code, type);
+
+  // compare the text as well so a hash collision can never alias stages
+  auto [first, last] = stages.equal_range(key);
+  for (auto it = first; it != last; ++it)
+  {
+    if (it->second.type == type && it->second.code == code)
+    {
+      reuseCount++;
+      return it->second.shader;
+    }
+  }
+
+  const char* source = code.c_str();
+  unsigned int shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, NULL);
+  glCompileShader(shader);
+  compileCount++;
+
+  stages.emplace(key, Stage{ type, code, shader });
+  return shader;
+}
+
+void ShaderStageCache::clear()
+{
+  // objects still attached to a program are only flagged for deletion
+  for (auto& [key, stage] : stages)
+    glDeleteShader(stage.shader);
+  stages.clear();
+}
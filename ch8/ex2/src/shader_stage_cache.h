@@ -0,0 +1,44 @@
+#ifndef SHADER_STAGE_CACHE_H
+#define SHADER_STAGE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// Compiled shader objects shared between programs, addressed by stage type
+// and source content. Programs that use the same preprocessed stage attach
+// the existing object instead of compiling it again. The cache owns the
+// objects; they live until clear() or destruction.
+class ShaderStageCache
+{
+  public:
+    ShaderStageCache() = default;
+    ~ShaderStageCache();
+
+    ShaderStageCache(const ShaderStageCache&) = delete;
+    ShaderStageCache& operator=(const ShaderStageCache&) = delete;
+
+    // shader object for this stage, compiled on first request; the compile
+    // status is left for the program build to check
+    unsigned int get(GLenum type, const std::string& code);
+    void clear();
+
+    unsigned int compiles() const { return compileCount; }
+    unsigned int reuses() const { return reuseCount; }
+
+  private:
+    struct Stage
+    {
+      GLenum type;
+      std::string code;
+      unsigned int shader;
+    };
+
+    std::unordered_multimap<std::uint64_t, Stage> stages;
+    unsigned int compileCount = 0;
+    unsigned int reuseCount = 0;
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include <glad/glad.h>
+
+#include "shader_variants.h"
+#include "gl_state.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+ShaderVariants::ShaderVariants(const char* vertexPath, const char* fragmentPath, ShaderOptions options)
+  : vertexCode(Shader::readSource(vertexPath)),
+    fragmentCode(Shader::readSource(fragmentPath)),
+    baseOptions(std::move(options))
+{
+  vertexFeatures = collectFeatures(vertexCode);
+  fragmentFeatures = collectFeatures(fragmentCode);
+}
+
+ShaderVariants ShaderVariants::fromSource(std::string_view vertexSource, std::string_view fragmentSource,
+                                          ShaderOptions options)
+{
+  return ShaderVariants(vertexSource, fragmentSource, std::move(options), Source{});
+}
+
+ShaderVariants::ShaderVariants(std::string_view vertexSource, std::string_view fragmentSource, ShaderOptions options,
+                               Source)
+  : vertexCode(vertexSource),
+    fragmentCode(fragmentSource),
+    baseOptions(std::move(options))
+{
+  vertexFeatures = collectFeatures(vertexCode);
+  fragmentFeatures = collectFeatures(fragmentCode);
+}
+
+ShaderVariants::~ShaderVariants()
+{
+  for (auto& [key, shader] : variants)
+  {
+    GLState::forgetProgram(shader->ID);
+    glDeleteProgram(shader->ID);
+  }
+}
+
+ShaderVariants::Key ShaderVariants::collectFeatures(const std::string& code)
+{
+  Key declared = 0;
+  std::istringstream lines(code);
+  std::string line;
+  while (std::getline(lines, line))
+  {
+    std::istringstream words(line);
+    std::string hash, pragma, variant, name;
+    words >> hash;
+    if (hash == "#")
+    {
+      // "# pragma" is legal preprocessor spelling too
+      words >> pragma;
+    }
+    else if (hash == "#pragma")
+    {
+      pragma = "pragma";
+    }
+    else
+    {
+      continue;
+    }
+
+    if (pragma != "pragma" || !(words >> variant >> name) || variant != "variant")
+      continue;
+
+    auto it = std::find(featureNames.begin(), featureNames.end(), name);
+    if (it == featureNames.end())
+    {
+      if (featureNames.size() == 64)
+      {
+        std::cout << "ERROR::SHADER_VARIANTS::TOO_MANY_FEATURES " << name << std::endl;
+        continue;
+      }
+      it = featureNames.insert(featureNames.end(), name);
+    }
+    declared |= Key(1) << (it - featureNames.begin());
+  }
+  return declared;
+}
+
+std::vector<std::string> ShaderVariants::stageDefines(Key key, Key stageFeatures) const
+{
+  std::vector<std::string> defines = baseOptions.defines;
+  for (std::size_t i = 0; i < featureNames.size(); i++)
+    if (key & stageFeatures & (Key(1) << i))
+      defines.push_back(featureNames[i]);
+  return defines;
+}
+
+ShaderVariants::Key ShaderVariants::key(std::initializer_list<std::string_view> enabled) const
+{
+  Key result = 0;
+  for (std::string_view name : enabled)
+  {
+    auto it = std::find(featureNames.begin(), featureNames.end(), name);
+    if (it == featureNames.end())
+    {
+      std::cout << "ERROR::SHADER_VARIANTS::UNKNOWN_FEATURE " << name << std::endl;
+      continue;
+    }
+    result |= Key(1) << (it - featureNames.begin());
+  }
+  return result;
+}
+
+ShaderOptions ShaderVariants::options(Key key) const
+{
+  ShaderOptions result = baseOptions;
+  for (std::size_t i = 0; i < featureNames.size(); i++)
+    if (key & (Key(1) << i))
+      result.defines.push_back(featureNames[i]);
+  return result;
+}
+
+ShaderVariants::StageOptions ShaderVariants::watchOptions(Key key) const
+{
+  return { options(key), stageDefines(key, vertexFeatures), stageDefines(key, fragmentFeatures) };
+}
+
+void ShaderVariants::prefetch(Key key)
+{
+  if (variants.contains(key))
+    return;
+
+  variants.emplace(key, std::unique_ptr<Shader>(new Shader(
+    Shader::injectDefines(vertexCode, stageDefines(key, vertexFeatures)),
+    Shader::injectDefines(fragmentCode, stageDefines(key, fragmentFeatures)),
+    options(key), Shader::DeferredSource{})));
+}
+
+Shader& ShaderVariants::get(Key key)
+{
+  prefetch(key);
+  Shader& shader = *variants[key];
+  shader.finish();
+  return shader;
+}
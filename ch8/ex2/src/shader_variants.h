@@ -0,0 +1,83 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "shader.h"
+
+// One pair of shader sources compiled into permutations on demand. Feature
+// keys are declared in the sources with
+//
+//   #pragma variant NAME
+//
+// and a permutation is the set of keys that get "#define NAME" injected.
+// Sources are read once; each permutation is compiled the first time it is
+// requested and cached under its key, so only used variants cost anything.
+class ShaderVariants
+{
+  public:
+    using Key = std::uint64_t;
+
+    ShaderVariants(const char* vertexPath, const char* fragmentPath, ShaderOptions options = {});
+    // from sources already in memory (e.g. EmbeddedShaders); named like
+    // Shader::fromSource so a path can't be taken for GLSL
+    static ShaderVariants fromSource(std::string_view vertexSource, std::string_view fragmentSource,
+                                     ShaderOptions options = {});
+    ~ShaderVariants();
+
+    ShaderVariants(const ShaderVariants&) = delete;
+    ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+    // feature keys declared in either stage, in declaration order
+    const std::vector<std::string>& features() const { return featureNames; }
+
+    // key for a set of enabled features; unknown names are reported and ignored
+    Key key(std::initializer_list<std::string_view> enabled) const;
+    // the options a permutation is built with (base options plus its defines)
+    ShaderOptions options(Key key) const;
+    // the same split by stage, as the permutation is actually compiled: a
+    // define only goes to the stages declaring it. For ShaderWatcher, so a
+    // reload rebuilds the same program
+    struct StageOptions
+    {
+      ShaderOptions options;
+      std::vector<std::string> vertexDefines;
+      std::vector<std::string> fragmentDefines;
+    };
+    StageOptions watchOptions(Key key) const;
+
+    // start compiling a permutation without waiting for it
+    void prefetch(Key key);
+    // the permutation, compiled on first use
+    Shader& get(Key key);
+    Shader& get(std::initializer_list<std::string_view> enabled) { return get(key(enabled)); }
+
+    std::size_t compiledCount() const { return variants.size(); }
+
+  private:
+    struct Source {};
+    ShaderVariants(std::string_view vertexSource, std::string_view fragmentSource, ShaderOptions options, Source);
+
+    std::string vertexCode;
+    std::string fragmentCode;
+    ShaderOptions baseOptions;
+    std::vector<std::string> featureNames;
+    // features each stage declares; a define only goes to the stages that
+    // declare it so untouched stages stay identical and can be shared
+    Key vertexFeatures = 0;
+    Key fragmentFeatures = 0;
+    std::unordered_map<Key, std::unique_ptr<Shader>> variants;
+
+    Key collectFeatures(const std::string& code);
+    std::vector<std::string> stageDefines(Key key, Key stageFeatures) const;
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include <glad/glad.h>
+
+#include "shader_watcher.h"
+#include "gl_state.h"
+#include "program_pipelines.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+ShaderWatcher::ShaderWatcher(ProgramPipelines* pipelines)
+  : programPipelines(pipelines)
+{
+#ifdef __linux__
+  notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (notifyFd < 0)
+  {
+    std::cout << "ERROR::SHADER_WATCHER::INOTIFY_INIT_FAILED" << std::endl;
+    return;
+  }
+  running = true;
+  thread = std::thread(&ShaderWatcher::run, this);
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+  running = false;
+  if (thread.joinable())
+    thread.join();
+#ifdef __linux__
+  if (notifyFd >= 0)
+    close(notifyFd);
+#endif
+  for (Entry& entry : entries)
+    if (entry.rebuilding)
+      glDeleteProgram(entry.rebuilding->ID);
+}
+
+void ShaderWatcher::watch(Shader& shader, std::string vertexPath, std::string fragmentPath, ShaderOptions options)
+{
+  std::vector<std::string> defines = options.defines;
+  watch(shader, std::move(vertexPath), std::move(fragmentPath), std::move(options), defines, defines);
+}
+
+void ShaderWatcher::watchStage(Shader& stage, GLenum type, std::string path, ShaderOptions options)
+{
+  // the other stage's path stays empty
+  std::string vertexPath = type == GL_VERTEX_SHADER ? std::move(path) : std::string();
+  std::string fragmentPath = type == GL_FRAGMENT_SHADER ? std::move(path) : std::string();
+  watch(stage, std::move(vertexPath), std::move(fragmentPath), std::move(options));
+}
+
+void ShaderWatcher::watch(Shader& shader, std::string vertexPath, std::string fragmentPath, ShaderOptions options,
+                          std::vector<std::string> vertexDefines, std::vector<std::string> fragmentDefines)
+{
+  std::lock_guard<std::mutex> lock(pendingMutex);
+  entries.push_back({ &shader, std::move(vertexPath), std::move(fragmentPath), std::move(options),
+                      std::move(vertexDefines), std::move(fragmentDefines), nullptr });
+
+#ifdef __linux__
+  // watch the directories rather than the files: editors often save by
+  // writing a new file and renaming it over the old one
+  for (const std::string* path : { &entries.back().vertexPath, &entries.back().fragmentPath })
+  {
+    if (path->empty())
+      continue;
+    std::string directory = std::filesystem::path(*path).parent_path().string();
+    if (directory.empty())
+      directory = ".";
+    bool known = std::any_of(directories.begin(), directories.end(),
+                             [&](const Directory& d) { return d.path == directory; });
+    if (notifyFd >= 0 && !known)
+    {
+      int watch = inotify_add_watch(notifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+      if (watch >= 0)
+        directories.push_back({ watch, directory });
+    }
+  }
+#endif
+}
+
+void ShaderWatcher::run()
+{
+#ifdef __linux__
+  alignas(inotify_event) char buffer[4096];
+  while (running)
+  {
+    pollfd descriptor = { notifyFd, POLLIN, 0 };
+    // wake up regularly to notice shutdown
+    if (::poll(&descriptor, 1, 100) <= 0)
+      continue;
+
+    ssize_t length;
+    while ((length = read(notifyFd, buffer, sizeof(buffer))) > 0)
+    {
+      for (char* at = buffer; at < buffer + length; )
+      {
+        const inotify_event* event = reinterpret_cast<const inotify_event*>(at);
+        if (event->len > 0)
+        {
+          std::string path;
+          {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            for (const Directory& directory : directories)
+              if (directory.watch == event->wd)
+                path = (std::filesystem::path(directory.path) / event->name).string();
+          }
+          if (!path.empty())
+            fileChanged(path);
+        }
+        at += sizeof(inotify_event) + event->len;
+      }
+    }
+  }
+#endif
+}
+
+void ShaderWatcher::fileChanged(const std::string& path)
+{
+  std::filesystem::path changed = std::filesystem::path(path).lexically_normal();
+
+  // copy what is needed under the lock so the files are read without it
+  struct Job
+  {
+    std::size_t entry;
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::vector<std::string> vertexDefines;
+    std::vector<std::string> fragmentDefines;
+  };
+  std::vector<Job> jobs;
+  {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    for (std::size_t i = 0; i < entries.size(); i++)
+    {
+      const Entry& entry = entries[i];
+      if ((!entry.vertexPath.empty() && changed == std::filesystem::path(entry.vertexPath).lexically_normal())
+          || (!entry.fragmentPath.empty() && changed == std::filesystem::path(entry.fragmentPath).lexically_normal()))
+        jobs.push_back({ i, entry.vertexPath, entry.fragmentPath, entry.vertexDefines, entry.fragmentDefines });
+    }
+  }
+
+  for (const Job& job : jobs)
+  {
+    // a stage's missing half stays empty
+    auto read = [](const std::string& file, const std::vector<std::string>& defines)
+    {
+      return file.empty() ? std::string() : Shader::injectDefines(Shader::readSource(file.c_str()), defines);
+    };
+    Sources sources = { job.entry, read(job.vertexPath, job.vertexDefines), read(job.fragmentPath, job.fragmentDefines) };
+
+    // a newer edit replaces one that has not been picked up yet
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    auto queued = std::find_if(pending.begin(), pending.end(),
+                               [&](const Sources& s) { return s.entry == job.entry; });
+    if (queued != pending.end())
+      *queued = std::move(sources);
+    else
+      pending.push_back(std::move(sources));
+  }
+}
+
+bool ShaderWatcher::poll()
+{
+  std::vector<Sources> ready;
+  {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    ready.swap(pending);
+  }
+
+  // submit new rebuilds; the driver compiles while we keep rendering
+  for (Sources& sources : ready)
+  {
+    Entry& entry = entries[sources.entry];
+    if (entry.rebuilding)
+      glDeleteProgram(entry.rebuilding->ID);
+    entry.rebuilding.reset(new Shader(sources.vertexCode, sources.fragmentCode, entry.options, Shader::DeferredSource{},
+                                      entry.shader->isSeparable()));
+  }
+
+  bool swapped = false;
+  for (Entry& entry : entries)
+  {
+    if (!entry.rebuilding || !entry.rebuilding->ready())
+      continue;
+
+    Shader& rebuilt = *entry.rebuilding;
+    rebuilt.finish();
+    if (rebuilt.valid())
+    {
+      std::swap(entry.shader->ID, rebuilt.ID);
+      std::swap(entry.shader->reflection, rebuilt.reflection);
+      entry.shader->linked = true;
+      std::cout << "Reloaded " << entry.vertexPath << " + " << entry.fragmentPath << std::endl;
+      swapped = true;
+    }
+    else
+    {
+      std::cout << "Reload failed, keeping the previous program" << std::endl;
+    }
+    // after a swap this holds the old program
+    if (programPipelines)
+      programPipelines->forget(rebuilt.ID);
+    GLState::forgetProgram(rebuilt.ID);
+    glDeleteProgram(rebuilt.ID);
+    entry.rebuilding.reset();
+  }
+  return swapped;
+}
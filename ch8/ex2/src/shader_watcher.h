@@ -0,0 +1,88 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shader.h"
+
+// Hot reload for shader sources. A background thread waits for edits
+// (inotify on Linux), then reads and preprocesses the new sources off the
+// render thread. poll() runs on the render thread at a frame boundary. It
+// submits the rebuild and swaps the new program in once the driver has
+// finished, keeping the old program if the new one fails to compile.
+// Separable stages (see Shader::stage) are rebuilt as stages.
+class ProgramPipelines;
+
+class ShaderWatcher
+{
+  public:
+    // pipelines using a replaced program are dropped from `pipelines`
+    explicit ShaderWatcher(ProgramPipelines* pipelines = nullptr);
+    ~ShaderWatcher();
+
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    // rebuild shader from these files whenever one of them changes
+    void watch(Shader& shader, std::string vertexPath, std::string fragmentPath, ShaderOptions options = {});
+    // the same with defines per stage in place of options.defines, e.g. from
+    // ShaderVariants::watchOptions()
+    void watch(Shader& shader, std::string vertexPath, std::string fragmentPath, ShaderOptions options,
+               std::vector<std::string> vertexDefines, std::vector<std::string> fragmentDefines);
+    // rebuild a single-stage separable program from its file
+    void watchStage(Shader& stage, GLenum type, std::string path, ShaderOptions options = {});
+    // call once per frame; returns true if any program was swapped, in which
+    // case uniform locations have to be looked up again
+    bool poll();
+
+  private:
+    struct Entry
+    {
+      Shader* shader;
+      std::string vertexPath;
+      std::string fragmentPath;
+      ShaderOptions options;
+      std::vector<std::string> vertexDefines;
+      std::vector<std::string> fragmentDefines;
+      // rebuild submitted to the driver but not swapped in yet
+      std::unique_ptr<Shader> rebuilding;
+    };
+
+    struct Sources
+    {
+      std::size_t entry;
+      std::string vertexCode;
+      std::string fragmentCode;
+    };
+
+    struct Directory
+    {
+      int watch;
+      std::string path;
+    };
+
+    std::vector<Entry> entries;
+    ProgramPipelines* programPipelines;
+    std::vector<Directory> directories;
+
+    // guards entries/directories against watch() and the pending queue,
+    // which is filled by the watcher thread and drained by poll()
+    std::mutex pendingMutex;
+    std::vector<Sources> pending;
+
+    std::atomic<bool> running{ false };
+    std::thread thread;
+    int notifyFd = -1;
+
+    void run();
+    void fileChanged(const std::string& path);
+};
+
+#endif
@@ -0,0 +1,241 @@
+#include <glad/glad.h>
+
+#include "texture_2d.h"
+#include "block_compression.h"
+#include "gl_state.h"
+#include "gpu_memory.h"
+
+#include <algorithm>
+#include <bit>
+#include <iostream>
+#include <utility>
+
+Texture2D::Texture2D()
+{
+  glGenTextures(1, &ID);
+}
+
+Texture2D::~Texture2D()
+{
+  if (ID)
+  {
+    GLState::forgetTexture(ID);
+    glDeleteTextures(1, &ID);
+  }
+  if (levelCount > 0)
+    GpuMemory::release(GpuMemory::Resource::Texture, bytes());
+}
+
+Texture2D::Texture2D(Texture2D&& other) noexcept
+  : ID(std::exchange(other.ID, 0)), levelWidth(other.levelWidth), levelHeight(other.levelHeight),
+    levelCount(std::exchange(other.levelCount, 0)), format(other.format), base(other.base),
+    firstStored(other.firstStored), immutableStorage(other.immutableStorage)
+{
+}
+
+Texture2D& Texture2D::operator=(Texture2D&& other) noexcept
+{
+  if (this != &other)
+  {
+    std::swap(ID, other.ID);
+    std::swap(levelWidth, other.levelWidth);
+    std::swap(levelHeight, other.levelHeight);
+    std::swap(levelCount, other.levelCount);
+    std::swap(format, other.format);
+    std::swap(base, other.base);
+    std::swap(firstStored, other.firstStored);
+    std::swap(immutableStorage, other.immutableStorage);
+  }
+  return *this;
+}
+
+void Texture2D::bind() const
+{
+  GLState::bindTexture(0, GL_TEXTURE_2D, ID);
+}
+
+bool Texture2D::allocate(int width, int height, GLenum internalFormat, int levels)
+{
+  if (levelCount > 0)
+  {
+    std::cout << "ERROR::TEXTURE_2D::ALREADY_ALLOCATED" << std::endl;
+    return false;
+  }
+  levelWidth = width;
+  levelHeight = height;
+  levelCount = levels > 0 ? std::min(levels, mipLevels(width, height)) : mipLevels(width, height);
+  format = internalFormat;
+  GpuMemory::allocate(GpuMemory::Resource::Texture, bytes());
+
+  bind();
+  if (GLAD_GL_ARB_texture_storage)
+  {
+    glTexStorage2D(GL_TEXTURE_2D, levelCount, internalFormat, width, height);
+    immutableStorage = true;
+    return true;
+  }
+
+  // the same levels, specified empty one by one
+  GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  for (int level = 0; level < levelCount; level++)
+    specifyLevel(level, false);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+  return true;
+}
+
+bool Texture2D::allocateFrom(int width, int height, GLenum internalFormat, int levels, int firstLevel)
+{
+  if (levelCount > 0)
+  {
+    std::cout << "ERROR::TEXTURE_2D::ALREADY_ALLOCATED" << std::endl;
+    return false;
+  }
+  levelWidth = width;
+  levelHeight = height;
+  levelCount = levels > 0 ? std::min(levels, mipLevels(width, height)) : mipLevels(width, height);
+  format = internalFormat;
+  base = firstStored = std::clamp(firstLevel, 0, coarsestBaseLevel());
+  GpuMemory::allocate(GpuMemory::Resource::Texture, bytes());
+
+  // levels below the base don't count for completeness, so they can
+  // stay unspecified
+  bind();
+  GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  for (int level = firstStored; level < levelCount; level++)
+    specifyLevel(level, false);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, base);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+  return true;
+}
+
+void Texture2D::reserveLevel(int level)
+{
+  if (level >= firstStored || level < 0)
+    return;
+  std::size_t before = bytes();
+  bind();
+  GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  for (int finer = level; finer < firstStored; finer++)
+    specifyLevel(finer, false);
+  firstStored = level;
+  GpuMemory::resize(GpuMemory::Resource::Texture, before, bytes());
+}
+
+void Texture2D::setBaseLevel(int level)
+{
+  level = std::clamp(level, firstStored, std::max(coarsestBaseLevel(), firstStored));
+  bind();
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+  base = level;
+  if (immutableStorage || level == firstStored)
+    return;
+
+  std::size_t before = bytes();
+  GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  for (int finer = firstStored; finer < level; finer++)
+    specifyLevel(finer, true);
+  firstStored = level;
+  GpuMemory::resize(GpuMemory::Resource::Texture, before, bytes());
+}
+
+void Texture2D::specifyLevel(int level, bool empty)
+{
+  int w = empty ? 0 : std::max(levelWidth >> level, 1);
+  int h = empty ? 0 : std::max(levelHeight >> level, 1);
+  BlockFormat blockFormat;
+  bool srgb;
+  if (blockFormatFromInternalFormat(format, blockFormat, srgb))
+    glCompressedTexImage2D(GL_TEXTURE_2D, level, format, w, h, 0,
+                           static_cast<GLsizei>(empty ? 0 : compressedSize(blockFormat, w, h)), nullptr);
+  else
+    glTexImage2D(GL_TEXTURE_2D, level, format, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+}
+
+void Texture2D::upload(int level, GLenum pixelFormat, GLenum type, const void* pixels)
+{
+  bind();
+  // rows of 1-3 channel images aren't 4-byte aligned in general
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, std::max(levelWidth >> level, 1), std::max(levelHeight >> level, 1),
+                  pixelFormat, type, pixels);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void Texture2D::uploadCompressed(int level, const void* data, std::size_t size)
+{
+  bind();
+  glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, std::max(levelWidth >> level, 1),
+                            std::max(levelHeight >> level, 1), format, static_cast<GLsizei>(size), data);
+}
+
+void Texture2D::generateMipmaps()
+{
+  bind();
+  glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+int Texture2D::coarsestBaseLevel() const
+{
+  if (immutableStorage)
+    return levelCount - 1;
+  int exact = std::min(std::countr_zero(static_cast<unsigned int>(levelWidth)),
+                       std::countr_zero(static_cast<unsigned int>(levelHeight)));
+  return std::min(exact, levelCount - 1);
+}
+
+std::size_t Texture2D::bytes() const
+{
+  return storageBytes(format, std::max(levelWidth >> firstStored, 1), std::max(levelHeight >> firstStored, 1),
+                      levelCount - firstStored);
+}
+
+GLenum Texture2D::internalFormatFor(int channels, bool srgb)
+{
+  static const GLenum linearFormats[] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+  static const GLenum srgbFormats[] = { GL_R8, GL_RG8, GL_SRGB8, GL_SRGB8_ALPHA8 };
+  return srgb ? srgbFormats[channels - 1] : linearFormats[channels - 1];
+}
+
+GLenum Texture2D::pixelFormatFor(int channels)
+{
+  static const GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+  return formats[channels - 1];
+}
+
+int Texture2D::mipLevels(int width, int height)
+{
+  int levels = 1;
+  for (int size = std::max(width, height); size > 1; size /= 2)
+    levels++;
+  return levels;
+}
+
+std::size_t Texture2D::storageBytes(GLenum internalFormat, int width, int height, int levels)
+{
+  BlockFormat blockFormat;
+  bool srgb;
+  bool compressed = blockFormatFromInternalFormat(internalFormat, blockFormat, srgb);
+  std::size_t pixelBytes = 4;
+  switch (internalFormat)
+  {
+    case GL_R8:
+      pixelBytes = 1;
+      break;
+    case GL_RG8:
+      pixelBytes = 2;
+      break;
+    case GL_RGB8:
+    case GL_SRGB8:
+      pixelBytes = 3;
+      break;
+  }
+
+  std::size_t bytes = 0;
+  for (int level = 0; level < levels; level++)
+  {
+    int w = std::max(width >> level, 1);
+    int h = std::max(height >> level, 1);
+    bytes += compressed ? compressedSize(blockFormat, w, h) : static_cast<std::size_t>(w) * h * pixelBytes;
+  }
+  return bytes;
+}
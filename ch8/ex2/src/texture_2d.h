@@ -0,0 +1,98 @@
+#ifndef TEXTURE_2D_H
+#define TEXTURE_2D_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// A GL_TEXTURE_2D whose storage is allocated once, with every level it
+// will ever have, through glTexStorage2D (GL 4.2 / ARB_texture_storage).
+// Pixels then go in with glTexSubImage2D or glCompressedTexSubImage2D, so
+// the driver never reallocates and the size in video memory is known up
+// front. Without the extension every level is specified empty with
+// glTexImage2D instead, which gives the same result minus immutability.
+//
+// For streaming, allocateFrom() gives storage to the coarse end of the
+// chain only. That storage is mutable, since levels come and go: finer
+// ones are added with reserveLevel() and sampled once setBaseLevel()
+// reaches them (GL_TEXTURE_BASE_LEVEL), and raising the base level again
+// frees them.
+//
+// The texture has no sampler state of its own (see SamplerCache). Its
+// storage is counted in GpuMemory.
+class Texture2D
+{
+  public:
+    // generates the name; needs a current context
+    Texture2D();
+    ~Texture2D();
+
+    Texture2D(const Texture2D&) = delete;
+    Texture2D& operator=(const Texture2D&) = delete;
+    Texture2D(Texture2D&& other) noexcept;
+    Texture2D& operator=(Texture2D&& other) noexcept;
+
+    unsigned int id() const { return ID; }
+
+    // storage for `levels` levels (0: the full chain down to 1x1); false
+    // if it already has storage
+    bool allocate(int width, int height, GLenum internalFormat, int levels = 0);
+    // mutable storage for levels firstLevel..levels-1 of the chain of a
+    // width x height image, sampled from firstLevel on
+    bool allocateFrom(int width, int height, GLenum internalFormat, int levels, int firstLevel);
+    // add storage for the levels from `level` up to the finest stored one,
+    // to upload into; they aren't sampled before setBaseLevel()
+    void reserveLevel(int level);
+    // sample from `level` on; stored levels finer than it are freed,
+    // unless the storage is immutable
+    void setBaseLevel(int level);
+    // replace a whole level. With a pixel unpack buffer bound, pixels is an
+    // offset into it. Rows are tightly packed
+    void upload(int level, GLenum format, GLenum type, const void* pixels);
+    // a whole level of a compressed internal format
+    void uploadCompressed(int level, const void* data, std::size_t size);
+    // fill every level below 0 from level 0
+    void generateMipmaps();
+
+    int width() const { return levelWidth; }
+    int height() const { return levelHeight; }
+    int levels() const { return levelCount; }
+    int baseLevel() const { return base; }
+    // the finest level with storage
+    int firstStoredLevel() const { return firstStored; }
+    // how far allocateFrom() and setBaseLevel() go on mutable storage: the
+    // size of level 0 has to follow from the base level's, or some drivers
+    // (Mesa) lose the coarse levels when finer ones are added
+    int coarsestBaseLevel() const;
+    GLenum internalFormat() const { return format; }
+    bool immutable() const { return immutableStorage; }
+    // video memory the levels take, as the format defines it (drivers may
+    // pad rows or align allocations on top of this)
+    std::size_t bytes() const;
+
+    // sized internal format for 8-bit images with 1 to 4 channels; sRGB
+    // only applies to the color of 3 and 4 channel images
+    static GLenum internalFormatFor(int channels, bool srgb);
+    // pixel format matching internalFormatFor
+    static GLenum pixelFormatFor(int channels);
+    // levels in the full chain of a width x height image
+    static int mipLevels(int width, int height);
+    static std::size_t storageBytes(GLenum internalFormat, int width, int height, int levels);
+
+  private:
+    unsigned int ID = 0;
+    int levelWidth = 0;
+    int levelHeight = 0;
+    int levelCount = 0;
+    GLenum format = 0;
+    int base = 0;
+    int firstStored = 0;
+    bool immutableStorage = false;
+
+    void bind() const;
+    // glTexImage2D or glCompressedTexImage2D without pixels; an empty level
+    // has no storage
+    void specifyLevel(int level, bool empty);
+};
+
+#endif
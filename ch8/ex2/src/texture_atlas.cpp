@@ -0,0 +1,273 @@
+#include "texture_atlas.h"
+#include "gl_state.h"
+#include "gpu_memory.h"
+#include "stb_image.h"
+#include "texture_2d.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <utility>
+
+TextureAtlas::TextureAtlas(const Options& atlasOptions) : options(atlasOptions)
+{
+}
+
+TextureAtlas::~TextureAtlas()
+{
+  for (std::size_t i = 0; i < textures.size(); i++)
+  {
+    GLState::forgetTexture(textures[i]);
+    glDeleteTextures(1, &textures[i]);
+    GpuMemory::release(GpuMemory::Resource::Texture, textureBytes[i]);
+  }
+}
+
+int TextureAtlas::add(const std::string& path, bool flipVertically, bool repeat)
+{
+  int width, height, channels;
+  stbi_set_flip_vertically_on_load(flipVertically);
+  unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+  if (!pixels)
+  {
+    std::cout << "ERROR::TEXTURE_ATLAS::DECODE_FAILED " << path << ": " << stbi_failure_reason() << std::endl;
+    return -1;
+  }
+  int id = add(pixels, width, height, 4, repeat);
+  stbi_image_free(pixels);
+  return id;
+}
+
+int TextureAtlas::add(const unsigned char* pixels, int width, int height, int channels, bool repeat)
+{
+  if (built)
+  {
+    std::cout << "ERROR::TEXTURE_ATLAS::ALREADY_BUILT" << std::endl;
+    return -1;
+  }
+
+  // expanded the way stb_image does: grey to RGB, alpha 255 when missing
+  Image image{ width, height, repeat, std::vector<unsigned char>(static_cast<std::size_t>(width) * height * 4) };
+  for (std::size_t p = 0; p < static_cast<std::size_t>(width) * height; p++)
+  {
+    const unsigned char* in = pixels + p * channels;
+    unsigned char* out = &image.pixels[p * 4];
+    bool grey = channels < 3;
+    out[0] = in[0];
+    out[1] = grey ? in[0] : in[1];
+    out[2] = grey ? in[0] : in[2];
+    out[3] = channels == 2 ? in[1] : channels == 4 ? in[3] : 255;
+  }
+  images.push_back(std::move(image));
+  placements.emplace_back();
+  return static_cast<int>(images.size() - 1);
+}
+
+bool TextureAtlas::insert(std::vector<SkylineNode>& skyline, int pageSize, int width, int height, int& x, int& y)
+{
+  // bottom-left: the lowest position, leftmost among equals
+  int bestIndex = -1;
+  int bestY = INT_MAX;
+  for (std::size_t i = 0; i < skyline.size() && skyline[i].x + width <= pageSize; i++)
+  {
+    int top = 0;
+    for (std::size_t j = i, covered = 0; covered < static_cast<std::size_t>(width); j++)
+    {
+      top = std::max(top, skyline[j].y);
+      covered += skyline[j].width;
+    }
+    if (top + height <= pageSize && top < bestY)
+    {
+      bestIndex = static_cast<int>(i);
+      bestY = top;
+    }
+  }
+  if (bestIndex < 0)
+    return false;
+
+  x = skyline[bestIndex].x;
+  y = bestY;
+  skyline.insert(skyline.begin() + bestIndex, { x, y + height, width });
+
+  // the new segment covers the start of the ones after it
+  for (std::size_t i = bestIndex + 1; i < skyline.size();)
+  {
+    int overlap = x + width - skyline[i].x;
+    if (overlap <= 0)
+      break;
+    skyline[i].x += overlap;
+    skyline[i].width -= overlap;
+    if (skyline[i].width > 0)
+      break;
+    skyline.erase(skyline.begin() + i);
+  }
+  for (std::size_t i = 0; i + 1 < skyline.size();)
+  {
+    if (skyline[i].y == skyline[i + 1].y)
+    {
+      skyline[i].width += skyline[i + 1].width;
+      skyline.erase(skyline.begin() + i + 1);
+    }
+    else
+    {
+      i++;
+    }
+  }
+  return true;
+}
+
+unsigned int TextureAtlas::createArray(int width, int height, int layers, int levels)
+{
+  unsigned int texture;
+  glGenTextures(1, &texture);
+  GLState::bindTexture(0, GL_TEXTURE_2D_ARRAY, texture);
+  levels = std::min(levels, Texture2D::mipLevels(width, height));
+  GLenum internalFormat = options.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+  if (GLAD_GL_ARB_texture_storage)
+  {
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, internalFormat, width, height, layers);
+  }
+  else
+  {
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internalFormat, width, height, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+  }
+  textures.push_back(texture);
+  textureBytes.push_back(Texture2D::storageBytes(internalFormat, width, height, levels) * layers);
+  GpuMemory::allocate(GpuMemory::Resource::Texture, textureBytes.back());
+  return texture;
+}
+
+void TextureAtlas::uploadPadded(const Image& image, int x, int y, int layer)
+{
+  int padding = options.padding;
+  int paddedWidth = image.width + 2 * padding;
+  int paddedHeight = image.height + 2 * padding;
+  std::vector<unsigned char> padded(static_cast<std::size_t>(paddedWidth) * paddedHeight * 4);
+  for (int py = 0; py < paddedHeight; py++)
+  {
+    int sy = std::clamp(py - padding, 0, image.height - 1);
+    for (int px = 0; px < paddedWidth; px++)
+    {
+      int sx = std::clamp(px - padding, 0, image.width - 1);
+      std::copy_n(&image.pixels[(static_cast<std::size_t>(sy) * image.width + sx) * 4], 4,
+                  &padded[(static_cast<std::size_t>(py) * paddedWidth + px) * 4]);
+    }
+  }
+  glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, y, layer, paddedWidth, paddedHeight, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                  padded.data());
+}
+
+void TextureAtlas::build()
+{
+  if (built)
+    return;
+  built = true;
+  GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  // split into atlased images and same-size groups
+  int padding = options.padding;
+  std::vector<int> packed;
+  std::map<std::pair<int, int>, std::vector<int>> groups;
+  for (std::size_t id = 0; id < images.size(); id++)
+  {
+    const Image& image = images[id];
+    bool small = image.width <= options.maxPacked && image.height <= options.maxPacked
+                 && image.width + 2 * padding <= options.pageSize && image.height + 2 * padding <= options.pageSize;
+    if (small && !image.repeat)
+      packed.push_back(static_cast<int>(id));
+    else
+      groups[{ image.width, image.height }].push_back(static_cast<int>(id));
+  }
+
+  // tallest first keeps the skyline flat
+  std::sort(packed.begin(), packed.end(), [this](int a, int b)
+  {
+    return std::make_pair(images[a].height, images[a].width) > std::make_pair(images[b].height, images[b].width);
+  });
+  std::vector<std::vector<SkylineNode>> pages;
+  std::vector<int> pageOf(images.size()), xOf(images.size()), yOf(images.size());
+  int usedWidth = 0, usedHeight = 0;
+  for (int id : packed)
+  {
+    int width = images[id].width + 2 * padding;
+    int height = images[id].height + 2 * padding;
+    std::size_t page = 0;
+    while (page < pages.size() && !insert(pages[page], options.pageSize, width, height, xOf[id], yOf[id]))
+      page++;
+    if (page == pages.size())
+    {
+      pages.push_back({ { 0, 0, options.pageSize } });
+      insert(pages[page], options.pageSize, width, height, xOf[id], yOf[id]);
+    }
+    pageOf[id] = static_cast<int>(page);
+    usedWidth = std::max(usedWidth, xOf[id] + width);
+    usedHeight = std::max(usedHeight, yOf[id] + height);
+    packedArea += static_cast<std::size_t>(width) * height;
+  }
+
+  // pages are layers of one array, cropped to the area any page uses
+  if (!pages.empty())
+  {
+    pageCount = static_cast<int>(pages.size());
+    pageArea = static_cast<std::size_t>(usedWidth) * usedHeight * pageCount;
+    // below this level the padding is gone and neighbours would bleed in
+    int levels = static_cast<int>(std::log2(std::max(padding, 1))) + 1;
+    unsigned int texture = createArray(usedWidth, usedHeight, pageCount, levels);
+    for (int id : packed)
+    {
+      uploadPadded(images[id], xOf[id], yOf[id], pageOf[id]);
+      Placement& placement = placements[id];
+      placement.texture = texture;
+      placement.layer = pageOf[id];
+      placement.packed = true;
+      placement.offset = glm::vec2(static_cast<float>(xOf[id] + padding) / usedWidth,
+                                   static_cast<float>(yOf[id] + padding) / usedHeight);
+      placement.scale = glm::vec2(static_cast<float>(images[id].width) / usedWidth,
+                                  static_cast<float>(images[id].height) / usedHeight);
+    }
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+  }
+
+  for (const auto& [size, ids] : groups)
+  {
+    unsigned int texture = createArray(size.first, size.second, static_cast<int>(ids.size()),
+                                       Texture2D::mipLevels(size.first, size.second));
+    for (std::size_t layer = 0; layer < ids.size(); layer++)
+    {
+      glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<int>(layer), size.first, size.second, 1, GL_RGBA,
+                      GL_UNSIGNED_BYTE, images[ids[layer]].pixels.data());
+      placements[ids[layer]].texture = texture;
+      placements[ids[layer]].layer = static_cast<int>(layer);
+    }
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+  }
+
+  // the pixels live on the GPU now; the sizes stay for report()
+  for (Image& image : images)
+    std::vector<unsigned char>().swap(image.pixels);
+}
+
+void TextureAtlas::remapTexCoords(int id, std::span<float> vertices, int stride, int uvOffset, int layerOffset) const
+{
+  const Placement& p = placements[id];
+  for (std::size_t v = 0; v + stride <= vertices.size(); v += stride)
+  {
+    float* uv = &vertices[v + uvOffset];
+    uv[0] = p.offset.x + uv[0] * p.scale.x;
+    uv[1] = p.offset.y + uv[1] * p.scale.y;
+    if (layerOffset >= 0)
+      vertices[v + layerOffset] = static_cast<float>(p.layer);
+  }
+}
+
+void TextureAtlas::report() const
+{
+  std::cout << "Texture atlas: " << images.size() << " images in " << textures.size() << " array textures, "
+            << pageCount << " atlas pages";
+  if (pageCount > 0)
+    std::cout << " (" << 100.0 * packedArea / pageArea << "% of page area used)";
+  std::cout << std::endl;
+}
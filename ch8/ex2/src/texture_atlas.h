@@ -0,0 +1,113 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+// Packs many images into a few GL_TEXTURE_2D_ARRAY textures so draws with
+// different images can share one bind:
+//
+//   - small images (both sides up to Options::maxPacked) are packed into
+//     atlas pages with a skyline bin packer, each page one layer,
+//   - other images are grouped by size, one layer each.
+//
+// Everything is sampled the same way, through a sampler2DArray with
+// vec3(offset + uv * scale, layer), so a shader doesn't care where an
+// image ended up. remapTexCoords() bakes that into vertex data at load time.
+//
+// Atlased images are surrounded by `padding` copies of their edge pixels
+// so bilinear filtering and the first mips don't bleed in neighbours. They
+// can't repeat, so images that tile are added with repeat = true and get
+// a layer of their own. The arrays carry no sampler state: atlas pages
+// need a clamp-to-edge sampler, the other layers can use any.
+class TextureAtlas
+{
+  public:
+    struct Options
+    {
+      int pageSize = 2048;
+      int maxPacked = 256;
+      int padding = 4;
+      // color is sRGB encoded
+      bool srgb = true;
+    };
+
+    // where an image lives once build() has run
+    struct Placement
+    {
+      unsigned int texture = 0;
+      int layer = 0;
+      // uv' = offset + uv * scale
+      glm::vec2 offset{ 0.0f };
+      glm::vec2 scale{ 1.0f };
+      // in an atlas page, so only clamp-to-edge wrapping is correct
+      bool packed = false;
+    };
+
+    explicit TextureAtlas(const Options& options);
+    TextureAtlas() : TextureAtlas(Options{}) {}
+    ~TextureAtlas();
+
+    TextureAtlas(const TextureAtlas&) = delete;
+    TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+    // queue an image; returns its id, or -1 if it can't be read
+    int add(const std::string& path, bool flipVertically = true, bool repeat = false);
+    // 8-bit pixels with 1 to 4 channels, copied
+    int add(const unsigned char* pixels, int width, int height, int channels, bool repeat = false);
+
+    // pack and upload everything added so far and free the CPU copies;
+    // only once per atlas
+    void build();
+
+    const Placement& placement(int id) const { return placements[id]; }
+    // rewrite the uvs of interleaved vertices for image `id`; `stride` and
+    // the offsets are in floats. The layer is written too if layerOffset >= 0
+    void remapTexCoords(int id, std::span<float> vertices, int stride, int uvOffset, int layerOffset = -1) const;
+
+    // array textures created, and how much of the atlas pages is used
+    std::size_t textureCount() const { return textures.size(); }
+    void report() const;
+
+  private:
+    struct Image
+    {
+      int width;
+      int height;
+      bool repeat;
+      // RGBA8
+      std::vector<unsigned char> pixels;
+    };
+
+    // one horizontal segment of the top edge of the packed area
+    struct SkylineNode
+    {
+      int x;
+      int y;
+      int width;
+    };
+
+    Options options;
+    std::vector<Image> images;
+    std::vector<Placement> placements;
+    std::vector<unsigned int> textures;
+    // video memory of each array, for GpuMemory
+    std::vector<std::size_t> textureBytes;
+    // padded image area and total area of the (cropped) atlas pages
+    std::size_t packedArea = 0;
+    std::size_t pageArea = 0;
+    int pageCount = 0;
+    bool built = false;
+
+    // returns false if the page has no room; x/y get the padded rectangle
+    static bool insert(std::vector<SkylineNode>& skyline, int pageSize, int width, int height, int& x, int& y);
+    unsigned int createArray(int width, int height, int layers, int levels);
+    void uploadPadded(const Image& image, int x, int y, int layer);
+};
+
+#endif
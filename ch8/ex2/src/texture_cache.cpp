@@ -0,0 +1,430 @@
+#include <glad/glad.h>
+
+#include "texture_cache.h"
+#include "block_compression.h"
+#include "gl_state.h"
+#include "gpu_memory.h"
+#include "hash.h"
+#include "mapped_file.h"
+#include "mip_generator.h"
+#include "stb_image.h"
+#include "texture_2d.h"
+#include "texture_file.h"
+#include "texture_streamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+
+TextureCache::~TextureCache()
+{
+  if (counters.resident > 0)
+    std::cout << "ERROR::TEXTURE_CACHE::HANDLES_OUTLIVE_CACHE " << counters.resident << std::endl;
+}
+
+TextureCache::Handle TextureCache::load(const std::string& path, bool flipVertically, bool srgb)
+{
+  // the same file flipped and not flipped, or as sRGB and linear, are
+  // different textures
+  std::string pathKey = std::string(flipVertically ? "1" : "0") + (srgb ? "s:" : "l:")
+                        + std::filesystem::path(path).lexically_normal().string();
+  auto byPathIt = byPath.find(pathKey);
+  if (byPathIt != byPath.end())
+  {
+    if (Handle texture = byPathIt->second.lock())
+    {
+      counters.pathHits++;
+      return texture;
+    }
+    byPath.erase(byPathIt);
+  }
+
+  // cooked files are mapped and uploaded level by level, nothing to decode
+  if (pathKey.ends_with(".tex"))
+  {
+    TextureFile file;
+    if (!file.open(path))
+      return nullptr;
+    std::uint64_t contentKey = fnv1a(file.bytes());
+    if (Handle texture = findContent(contentKey, pathKey))
+      return texture;
+
+    Handle texture = uploadCooked(file, path);
+    byPath[pathKey] = texture;
+    byContent[contentKey] = texture;
+    return texture;
+  }
+
+  if (textureStreamer)
+  {
+    Handle texture = stream(path, flipVertically, srgb);
+    byPath[pathKey] = texture;
+    return texture;
+  }
+
+  // hashed and decoded from the mapping, without a copy on the heap
+  MappedFile file;
+  if (!file.open(path))
+  {
+    std::cout << "ERROR::TEXTURE_CACHE::FILE_NOT_SUCCESSFULLY_READ " << path << std::endl;
+    return nullptr;
+  }
+
+  std::uint64_t contentKey = fnv1a(file.bytes()) ^ (flipVertically ? 1 : 0) ^ (srgb ? 2 : 0);
+  if (Handle texture = findContent(contentKey, pathKey))
+    return texture;
+
+  int width, height, channels;
+  stbi_set_flip_vertically_on_load(flipVertically);
+  unsigned char* pixels = stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &width, &height,
+                                                &channels, 0);
+  file.close();
+  if (!pixels)
+  {
+    std::cout << "ERROR::TEXTURE_CACHE::DECODE_FAILED " << path << ": " << stbi_failure_reason() << std::endl;
+    return nullptr;
+  }
+  counters.decodes++;
+
+  Handle texture;
+  if (maxImageSize > 0 && std::max(width, height) > maxImageSize)
+  {
+    MipOptions options;
+    options.maxSize = maxImageSize;
+    options.srgb = srgb;
+    MipLevel level = downscaleToFit(pixels, width, height, channels, options);
+    texture = upload(level.pixels.data(), level.width, level.height, channels, srgb);
+  }
+  else
+  {
+    texture = upload(pixels, width, height, channels, srgb);
+  }
+  stbi_image_free(pixels);
+
+  byPath[pathKey] = texture;
+  byContent[contentKey] = texture;
+  return texture;
+}
+
+void TextureCache::clampImages(int size)
+{
+  maxImageSize = size;
+  if (textureStreamer)
+    textureStreamer->clampImages(size);
+}
+
+TextureCache::Handle TextureCache::findContent(std::uint64_t contentKey, const std::string& pathKey)
+{
+  auto it = byContent.find(contentKey);
+  if (it == byContent.end())
+    return nullptr;
+
+  Handle texture = it->second.lock();
+  if (!texture)
+  {
+    byContent.erase(it);
+    return nullptr;
+  }
+  counters.contentHits++;
+  byPath[pathKey] = texture;
+  return texture;
+}
+
+TextureCache::Entry* TextureCache::create()
+{
+  Entry* entry = new Entry();
+  entry->ID = entry->image.id();
+  entry->droppedLevels = 0;
+  entries.push_back(entry);
+  counters.resident++;
+  return entry;
+}
+
+TextureCache::Handle TextureCache::stream(const std::string& path, bool flipVertically, bool srgb)
+{
+  Entry* entry = create();
+  streaming[entry] = textureStreamer->load(entry->image, path, flipVertically, srgb,
+    [this, entry](int width, int height, int channels)
+    {
+      streaming.erase(entry);
+      if (width == 0)
+        return;
+      counters.decodes++;
+      entry->width = width;
+      entry->height = height;
+      entry->channels = channels;
+      entry->bytes = entry->image.bytes();
+      counters.residentBytes += entry->bytes;
+    });
+  return Handle(entry, [this](const Texture* released) { release(released); });
+}
+
+TextureCache::Handle TextureCache::upload(const unsigned char* pixels, int width, int height, int channels,
+                                          bool srgb)
+{
+  Entry* entry = create();
+  entry->width = width;
+  entry->height = height;
+  entry->channels = channels;
+
+  GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  entry->image.allocate(width, height, Texture2D::internalFormatFor(channels, srgb));
+  entry->image.upload(0, Texture2D::pixelFormatFor(channels), GL_UNSIGNED_BYTE, pixels);
+  entry->image.generateMipmaps();
+
+  entry->bytes = entry->image.bytes();
+  counters.residentBytes += entry->bytes;
+  return Handle(entry, [this](const Texture* released) { release(released); });
+}
+
+TextureCache::Handle TextureCache::uploadCooked(const TextureFile& file, const std::string& path)
+{
+  const TextureFileHeader& header = file.header();
+  Entry* entry = create();
+  entry->width = header.width;
+  entry->height = header.height;
+  entry->channels = header.channels;
+  entry->source = path;
+
+  // every level is in the file, so the GPU has no mips to generate; when
+  // streaming, only the small ones go in now and the rest as draws need them
+  int firstLevel = 0;
+  if (textureStreamer && mipStreamSize > 0)
+  {
+    while (std::max(header.width >> firstLevel, header.height >> firstLevel) > static_cast<unsigned int>(mipStreamSize)
+           && firstLevel + 1 < static_cast<int>(header.levels))
+      firstLevel++;
+    entry->streamsMips = true;
+  }
+  if (!uploadLevels(entry->image, file, firstLevel, entry->streamsMips))
+    counters.blockFallbacks++;
+  // the texture may keep more levels than asked for (see
+  // Texture2D::coarsestBaseLevel), and uploads only what it has storage for
+  entry->droppedLevels = entry->image.baseLevel();
+
+  entry->bytes = entry->image.bytes();
+  counters.residentBytes += entry->bytes;
+  return Handle(entry, [this](const Texture* released) { release(released); });
+}
+
+bool TextureCache::uploadLevels(Texture2D& image, const TextureFile& file, int firstLevel, bool partial)
+{
+  const TextureFileHeader& header = file.header();
+  GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  BlockFormat blockFormat;
+  bool srgb;
+  bool compressed = header.format == 0 && blockFormatFromInternalFormat(header.internalFormat, blockFormat, srgb);
+  // a driver without the block format gets the decoded pixels
+  bool decode = compressed && !compressedFormatSupported(blockFormat, srgb);
+  GLenum internalFormat = decode ? (srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8) : header.internalFormat;
+  TextureFile::Level first = file.level(firstLevel);
+  if (partial)
+  {
+    image.allocateFrom(header.width, header.height, internalFormat, header.levels, firstLevel);
+    firstLevel = image.firstStoredLevel();
+  }
+  else
+    image.allocate(first.width, first.height, internalFormat, header.levels - firstLevel);
+  // the file's level i is the texture's level i, or i - firstLevel once the
+  // top levels are gone for good
+  int shift = partial ? 0 : firstLevel;
+  for (unsigned int i = firstLevel; i < header.levels; i++)
+  {
+    TextureFile::Level level = file.level(i);
+    if (decode)
+    {
+      std::vector<unsigned char> pixels = decompressImage(level.data, level.width, level.height, blockFormat);
+      image.upload(i - shift, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    }
+    else if (compressed)
+    {
+      // the blocks stay compressed in video memory too
+      image.uploadCompressed(i - shift, level.data, level.size);
+    }
+    else
+    {
+      image.upload(i - shift, header.format, header.type, level.data);
+    }
+  }
+  return !decode;
+}
+
+void TextureCache::bind(unsigned int unit, const Handle& texture)
+{
+  if (!texture)
+  {
+    GLState::bindTexture(unit, GL_TEXTURE_2D, 0);
+    return;
+  }
+  // only the cache hands out handles, so this is one of our entries
+  Entry* entry = const_cast<Entry*>(static_cast<const Entry*>(texture.get()));
+  entry->lastUse = frame;
+  GLState::bindTexture(unit, GL_TEXTURE_2D, entry->ID);
+}
+
+void TextureCache::require(const Handle& texture, float level)
+{
+  if (!texture)
+    return;
+  Entry* entry = const_cast<Entry*>(static_cast<const Entry*>(texture.get()));
+  // the finest level sampled is the floor of lambda
+  int wanted = std::max(static_cast<int>(std::floor(level)), 0);
+  entry->wantedLevel = entry->wantedFrame == frame ? std::min(entry->wantedLevel, wanted) : wanted;
+  entry->wantedFrame = frame;
+}
+
+bool TextureCache::enforceBudget()
+{
+  bool dropped = false;
+  // a level at a time from the least recently bound, so a texture that is
+  // still drawn loses detail last
+  while (GpuMemory::excess() > 0)
+  {
+    // not while a level is on its way, which would land above a gap
+    Entry* victim = nullptr;
+    for (Entry* entry : entries)
+      if (!entry->source.empty() && !streaming.contains(entry)
+          && (entry->streamsMips ? entry->image.baseLevel() < entry->image.coarsestBaseLevel()
+                                 : entry->image.levels() > 1)
+          && (!victim || entry->lastUse < victim->lastUse))
+        victim = entry;
+    if (!victim)
+      break;
+    if (victim->streamsMips)
+      setBaseLevel(victim, victim->droppedLevels + 1);
+    else if (!resize(victim, victim->droppedLevels + 1))
+      break;
+    counters.levelsDropped++;
+    dropped = true;
+  }
+
+  // what was bound since the last call comes back once it fits: cooked
+  // textures whole, mip-streamed ones a level at a time down to the level
+  // they were required at. Not in a frame that had to drop levels, or the
+  // two would take turns
+  bool restored = false;
+  std::size_t budget = GpuMemory::budget();
+  for (Entry* entry : entries)
+  {
+    if (dropped || entry->droppedLevels == 0 || entry->lastUse != frame)
+      continue;
+    if (entry->streamsMips)
+    {
+      int wanted = entry->wantedFrame == frame ? entry->wantedLevel : 0;
+      int level = entry->droppedLevels - 1;
+      std::size_t levelBytes = Texture2D::storageBytes(entry->image.internalFormat(), std::max(entry->width >> level, 1),
+                                                       std::max(entry->height >> level, 1), 1);
+      if (wanted <= level && !streaming.contains(entry) && (budget == 0 || GpuMemory::used() + levelBytes <= budget))
+        streamLevel(entry, level);
+      continue;
+    }
+    std::size_t full = Texture2D::storageBytes(entry->image.internalFormat(), entry->width, entry->height,
+                                               entry->image.levels() + entry->droppedLevels);
+    if (budget > 0 && GpuMemory::used() + full - entry->bytes > budget)
+      continue;
+    int levels = entry->droppedLevels;
+    if (resize(entry, 0))
+    {
+      counters.levelsRestored += levels;
+      restored = true;
+    }
+  }
+  frame++;
+  restored = restored || levelsArrived;
+  levelsArrived = false;
+  return dropped || restored;
+}
+
+void TextureCache::streamLevel(Entry* entry, int level)
+{
+  streaming[entry] = textureStreamer->loadLevel(entry->image, entry->source, level,
+    [this, entry, level](int width, int, int)
+    {
+      streaming.erase(entry);
+      if (width == 0)
+        return;
+      setBaseLevel(entry, level);
+      counters.levelsStreamed++;
+      levelsArrived = true;
+    });
+}
+
+void TextureCache::setBaseLevel(Entry* entry, int level)
+{
+  entry->image.setBaseLevel(level);
+  counters.residentBytes -= entry->bytes;
+  entry->bytes = entry->image.bytes();
+  entry->droppedLevels = entry->image.baseLevel();
+  counters.residentBytes += entry->bytes;
+}
+
+bool TextureCache::resize(Entry* entry, int dropped)
+{
+  TextureFile file;
+  if (!file.open(entry->source))
+    return false;
+  if (dropped >= static_cast<int>(file.header().levels))
+    return false;
+
+  // immutable storage can't shrink in place, and BASE_LEVEL alone would
+  // keep the memory, so the levels that stay are uploaded into a new one
+  Texture2D image;
+  uploadLevels(image, file, dropped, false);
+  counters.residentBytes -= entry->bytes;
+  entry->image = std::move(image);
+  entry->ID = entry->image.id();
+  entry->bytes = entry->image.bytes();
+  entry->droppedLevels = dropped;
+  counters.residentBytes += entry->bytes;
+  return true;
+}
+
+bool TextureCache::compressedFormatSupported(BlockFormat format, bool srgb)
+{
+  switch (format)
+  {
+    case BlockFormat::BC1:
+    case BlockFormat::BC3:
+      return GLAD_GL_EXT_texture_compression_s3tc && (!srgb || GLAD_GL_EXT_texture_sRGB);
+    case BlockFormat::BC7:
+      return GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 2)
+             || GLAD_GL_ARB_texture_compression_bptc;
+  }
+  return false;
+}
+
+void TextureCache::release(const Texture* texture)
+{
+  // a load still in flight must not land in a deleted (and reusable) name
+  auto pending = streaming.find(texture);
+  if (pending != streaming.end())
+  {
+    textureStreamer->cancel(pending->second);
+    streaming.erase(pending);
+  }
+
+  counters.residentBytes -= texture->bytes;
+  counters.resident--;
+  entries.erase(std::find(entries.begin(), entries.end(), texture));
+  // the Texture2D deletes the GL texture
+  delete static_cast<const Entry*>(texture);
+}
+
+void TextureCache::report() const
+{
+  std::cout << "Texture cache: " << counters.resident << " textures, " << counters.residentBytes / 1024
+            << " KiB resident, " << counters.decodes << " decodes, "
+            << counters.pathHits + counters.contentHits << " duplicate loads avoided ("
+            << counters.pathHits << " by path, " << counters.contentHits << " by content)";
+  if (counters.blockFallbacks > 0)
+    std::cout << ", " << counters.blockFallbacks << " compressed textures decoded on the CPU";
+  unsigned int reduced = 0;
+  for (const Entry* entry : entries)
+    reduced += entry->droppedLevels > 0;
+  if (counters.levelsDropped > 0 || reduced > 0)
+    std::cout << ", " << reduced << " textures without their top mips (" << counters.levelsDropped
+              << " levels dropped, " << counters.levelsRestored << " restored, " << counters.levelsStreamed
+              << " streamed in)";
+  std::cout << std::endl;
+}
@@ -0,0 +1,171 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "texture_2d.h"
+
+// 2D textures loaded from image files and shared between their users.
+// Paths ending in ".tex" are cooked files (see TextureFile) that are mapped
+// and uploaded with their stored mips; other images are decoded with
+// stb_image and get their mips generated, after clampImages() reduced the
+// oversized ones on the CPU. Cooked BC1/BC3/BC7 blocks are
+// uploaded as they are, or decoded on the CPU if the driver lacks the
+// format. A request is answered by path
+// first; a new path is read and hashed, and a file whose contents are
+// already resident (a copy under another name) is answered by content
+// without decoding or uploading it again.
+//
+// Every texture gets a full mip chain but no filtering or wrap state: that
+// comes from the sampler bound to its unit (see SamplerCache).
+//
+// Handles are reference counted: the GL texture is deleted when the last
+// handle to it goes away. The cache must outlive every handle it returned.
+//
+// With a TextureStreamer, misses return at once with a texture that gets
+// its pixels when the streamer's update() uploads them (width is 0 until
+// then). Streamed loads are deduplicated by path only, since the contents
+// are first read on a worker thread.
+//
+// Cooked textures can also give memory back: when GpuMemory is over its
+// budget, enforceBudget() drops the top mips of the least recently bound
+// ones, and brings them back from the file once they are bound again and
+// fit. Dropping reallocates the storage, so the ID changes; bind through
+// bind() rather than keeping it.
+//
+// With streamMips(), cooked textures start out with only their small
+// levels. The renderer tells require() which level its draws sample (see
+// texture_lod.h), and enforceBudget() has the streamer load the finer
+// levels one at a time, clamping sampling to what has arrived with
+// GL_TEXTURE_BASE_LEVEL. These textures drop levels by raising the base
+// level again, without reallocating.
+enum class BlockFormat;
+class TextureFile;
+class TextureStreamer;
+
+class TextureCache
+{
+  public:
+    struct Texture
+    {
+      unsigned int ID;
+      int width;
+      int height;
+      int channels;
+      // video memory of every level (see Texture2D::bytes)
+      std::size_t bytes;
+      // top levels not resident, dropped to stay in the budget or not
+      // streamed in yet; width and height are still those of level 0
+      int droppedLevels;
+    };
+    using Handle = std::shared_ptr<const Texture>;
+
+    struct Stats
+    {
+      std::size_t residentBytes = 0;
+      unsigned int resident = 0;
+      unsigned int decodes = 0;
+      // duplicate loads avoided, by path and by content
+      unsigned int pathHits = 0;
+      unsigned int contentHits = 0;
+      // compressed textures decoded on the CPU because the driver lacks
+      // their format
+      unsigned int blockFallbacks = 0;
+      // top mips dropped and brought back by enforceBudget()
+      unsigned int levelsDropped = 0;
+      unsigned int levelsRestored = 0;
+      // finer levels of mip-streamed textures loaded
+      unsigned int levelsStreamed = 0;
+    };
+
+    explicit TextureCache(TextureStreamer* streamer = nullptr) : textureStreamer(streamer) {}
+    ~TextureCache();
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    // an empty handle if the file can't be read or decoded. `srgb` says the
+    // color channels of an image are sRGB encoded, as the cooker assumes
+    // unless --linear; pass false for normal maps and masks. Cooked files
+    // carry their own format and ignore it
+    Handle load(const std::string& path, bool flipVertically = true, bool srgb = true);
+
+    // images (not cooked files) decoded from now on that are larger than
+    // `size` texels are reduced to the largest mip level that fits; 0
+    // uploads them whole
+    void clampImages(int size);
+    // cooked textures loaded from now on start with the levels up to `size`
+    // texels and stream the rest in; 0 loads whole chains. Needs a streamer
+    void streamMips(int size) { mipStreamSize = size; }
+
+    // bind to a unit through GLState, marking the texture as in use; an
+    // empty handle unbinds
+    void bind(unsigned int unit, const Handle& texture);
+    // the finest mip level a draw this frame samples the texture at; a
+    // texture that is bound without it wants level 0
+    void require(const Handle& texture, float level);
+    // once per frame: drop top mips of cooked textures, least recently
+    // bound first, while GpuMemory is over budget, otherwise restore the
+    // ones bound since the last call that fit again, or stream in their
+    // next level. True if any texture changed
+    bool enforceBudget();
+
+    Stats stats() const { return counters; }
+    void report() const;
+
+  private:
+    std::unordered_map<std::string, std::weak_ptr<const Texture>> byPath;
+    std::unordered_map<std::uint64_t, std::weak_ptr<const Texture>> byContent;
+    Stats counters;
+    TextureStreamer* textureStreamer;
+    // streamed textures still waiting for their pixels, by ticket
+    std::unordered_map<const Texture*, std::uint64_t> streaming;
+
+    // a Texture and the storage behind it
+    struct Entry : Texture
+    {
+      Texture2D image;
+      // the cooked file, to reload dropped levels from; empty if the
+      // texture can't drop any
+      std::string source;
+      unsigned int lastUse = 0;
+      // levels come and go through the streamer and the base level
+      bool streamsMips = false;
+      int wantedLevel = 0;
+      unsigned int wantedFrame = 0;
+    };
+    // every live texture, for eviction
+    std::vector<Entry*> entries;
+    // counts enforceBudget() calls; lastUse 0 is never bound
+    unsigned int frame = 1;
+    int mipStreamSize = 0;
+    int maxImageSize = 0;
+    // a streamed level was uploaded since the last enforceBudget()
+    bool levelsArrived = false;
+
+    Entry* create();
+    Handle stream(const std::string& path, bool flipVertically, bool srgb);
+    Handle findContent(std::uint64_t contentKey, const std::string& pathKey);
+    Handle upload(const unsigned char* pixels, int width, int height, int channels, bool srgb);
+    Handle uploadCooked(const TextureFile& file, const std::string& path);
+    // allocate `image` for the file's levels from firstLevel on and upload
+    // them, at their place in the full chain if `partial` (see
+    // Texture2D::allocateFrom), otherwise from level 0; false if the
+    // blocks had to be decoded
+    static bool uploadLevels(Texture2D& image, const TextureFile& file, int firstLevel, bool partial);
+    // reload the entry's texture without its top `dropped` levels
+    bool resize(Entry* entry, int dropped);
+    void streamLevel(Entry* entry, int level);
+    void setBaseLevel(Entry* entry, int level);
+    static bool compressedFormatSupported(BlockFormat format, bool srgb);
+    void release(const Texture* texture);
+};
+
+#endif
@@ -0,0 +1,150 @@
+#include "texture_file.h"
+#include "block_compression.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+  // GL enums, spelled out so the cooker needs no GL headers
+  constexpr std::uint32_t glUnsignedByte = 0x1401;
+  constexpr std::uint32_t pixelFormats[] = { 0x1903, 0x8227, 0x1907, 0x1908 };     // RED RG RGB RGBA
+  constexpr std::uint32_t linearFormats[] = { 0x8229, 0x822B, 0x8051, 0x8058 };    // R8 RG8 RGB8 RGBA8
+  constexpr std::uint32_t srgbFormats[] = { 0x8229, 0x822B, 0x8C41, 0x8C43 };      // R8 RG8 SRGB8 SRGB8_ALPHA8
+
+  // past any GL_MAX_TEXTURE_SIZE, and small enough that level sizes can't
+  // overflow
+  constexpr std::uint32_t maxDimension = 1 << 16;
+
+  std::size_t alignUp(std::size_t value)
+  {
+    return (value + 15) & ~std::size_t(15);
+  }
+
+  // as Texture2D::mipLevels, which the cooker can't link without GL
+  std::uint32_t fullChainLevels(std::uint32_t width, std::uint32_t height)
+  {
+    std::uint32_t levels = 1;
+    for (std::uint32_t size = std::max(width, height); size > 1; size /= 2)
+      levels++;
+    return levels;
+  }
+
+  // the formats go to GL as they are, so only the ones write() produces
+  // are accepted: blocks with format and type 0, or 8-bit pixels of the
+  // header's channel count
+  bool formatMatches(const TextureFileHeader& h)
+  {
+    BlockFormat blockFormat;
+    bool srgb;
+    if (blockFormatFromInternalFormat(h.internalFormat, blockFormat, srgb))
+      return h.format == 0 && h.type == 0;
+    return h.format == pixelFormats[h.channels - 1] && h.type == glUnsignedByte
+           && (h.internalFormat == linearFormats[h.channels - 1] || h.internalFormat == srgbFormats[h.channels - 1]);
+  }
+
+  // what level `index` of the header's chain has to hold
+  bool levelMatches(const TextureFileHeader& h, unsigned int index, const TextureFileLevel& entry)
+  {
+    std::uint32_t width = std::max(h.width >> index, 1u);
+    std::uint32_t height = std::max(h.height >> index, 1u);
+    if (entry.width != width || entry.height != height)
+      return false;
+
+    BlockFormat blockFormat;
+    bool srgb;
+    if (blockFormatFromInternalFormat(h.internalFormat, blockFormat, srgb))
+      return entry.size == compressedSize(blockFormat, static_cast<int>(width), static_cast<int>(height));
+    return entry.size == std::uint64_t(width) * height * h.channels;
+  }
+}
+
+bool TextureFile::open(const std::string& path)
+{
+  if (!file.open(path))
+  {
+    std::cout << "ERROR::TEXTURE_FILE::FILE_NOT_SUCCESSFULLY_READ " << path << std::endl;
+    return false;
+  }
+
+  // every level has to lie inside the file before anything reads it
+  const TextureFileHeader& h = header();
+  std::size_t length = file.size();
+  bool valid = length >= sizeof(TextureFileHeader) && std::memcmp(h.magic, magic, sizeof(magic)) == 0
+               && h.version == version && h.levels > 0 && h.levels <= 32
+               && length >= sizeof(TextureFileHeader) + h.levels * sizeof(TextureFileLevel);
+  // and the levels have to be the chain the header describes, since
+  // uploads size them from the header
+  valid = valid && h.width > 0 && h.height > 0 && h.width <= maxDimension && h.height <= maxDimension
+          && h.channels >= 1 && h.channels <= 4 && h.levels <= fullChainLevels(h.width, h.height)
+          && formatMatches(h);
+  for (unsigned int i = 0; valid && i < h.levels; i++)
+  {
+    const TextureFileLevel& entry = reinterpret_cast<const TextureFileLevel*>(&h + 1)[i];
+    valid = entry.offset <= length && entry.size <= length - entry.offset && levelMatches(h, i, entry);
+  }
+  if (!valid)
+  {
+    std::cout << "ERROR::TEXTURE_FILE::INVALID " << path << std::endl;
+    file.close();
+    return false;
+  }
+  return true;
+}
+
+TextureFile::Level TextureFile::level(unsigned int index) const
+{
+  const TextureFileLevel& entry = reinterpret_cast<const TextureFileLevel*>(&header() + 1)[index];
+  return { static_cast<int>(entry.width), static_cast<int>(entry.height),
+           file.data() + entry.offset, static_cast<std::size_t>(entry.size) };
+}
+
+bool TextureFile::write(const std::string& path, const std::vector<MipLevel>& chain, int channels, bool srgb)
+{
+  return write(path, chain, channels, srgb ? srgbFormats[channels - 1] : linearFormats[channels - 1],
+               pixelFormats[channels - 1], glUnsignedByte, srgb ? srgbFlag : 0);
+}
+
+bool TextureFile::write(const std::string& path, const std::vector<MipLevel>& chain, int channels,
+                        std::uint32_t internalFormat, std::uint32_t format, std::uint32_t type, std::uint32_t flags)
+{
+  TextureFileHeader h = {};
+  std::memcpy(h.magic, magic, sizeof(magic));
+  h.version = version;
+  h.width = chain.front().width;
+  h.height = chain.front().height;
+  h.levels = static_cast<std::uint32_t>(chain.size());
+  h.channels = channels;
+  h.internalFormat = internalFormat;
+  h.format = format;
+  h.type = type;
+  h.flags = flags;
+
+  std::vector<TextureFileLevel> entries;
+  std::size_t offset = alignUp(sizeof(TextureFileHeader) + chain.size() * sizeof(TextureFileLevel));
+  for (const MipLevel& level : chain)
+  {
+    entries.push_back({ offset, level.pixels.size(), static_cast<std::uint32_t>(level.width),
+                        static_cast<std::uint32_t>(level.height) });
+    offset = alignUp(offset + level.pixels.size());
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file)
+  {
+    std::cout << "ERROR::TEXTURE_FILE::WRITE_FAILED " << path << std::endl;
+    return false;
+  }
+  file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+  file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(TextureFileLevel));
+  const char padding[16] = {};
+  for (std::size_t i = 0; i < chain.size(); i++)
+  {
+    std::size_t position = static_cast<std::size_t>(file.tellp());
+    file.write(padding, entries[i].offset - position);
+    file.write(reinterpret_cast<const char*>(chain[i].pixels.data()), chain[i].pixels.size());
+  }
+  return static_cast<bool>(file);
+}
@@ -0,0 +1,83 @@
+#ifndef TEXTURE_FILE_H
+#define TEXTURE_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mapped_file.h"
+#include "mip_chain.h"
+
+// Cooked texture container (".tex"), written by the texture_cooker tool:
+//
+//   TextureFileHeader
+//   TextureFileLevel[levels]   largest first
+//   level data                 each level 16-byte aligned, rows packed
+//
+// Formats are stored as GL enums so levels go to glTexImage2D as they
+// are, and every level down to 1x1 is present. Block-compressed levels
+// have format and type 0 and go to glCompressedTexImage2D instead. All
+// fields are little endian.
+struct TextureFileHeader
+{
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t width;
+  std::uint32_t height;
+  std::uint32_t levels;
+  std::uint32_t channels;
+  // GL internal format, pixel format and type of every level
+  std::uint32_t internalFormat;
+  std::uint32_t format;
+  std::uint32_t type;
+  std::uint32_t flags;
+};
+
+struct TextureFileLevel
+{
+  std::uint64_t offset;
+  std::uint64_t size;
+  std::uint32_t width;
+  std::uint32_t height;
+};
+
+// A read-only, memory-mapped cooked texture. Level data points straight
+// into the mapping, so uploading copies from the page cache with no decode.
+class TextureFile
+{
+  public:
+    static constexpr char magic[4] = { 'T', 'E', 'X', 'C' };
+    static constexpr std::uint32_t version = 1;
+    // color channels are sRGB encoded
+    static constexpr std::uint32_t srgbFlag = 1;
+
+    struct Level
+    {
+      int width;
+      int height;
+      const unsigned char* data;
+      std::size_t size;
+    };
+
+    // map and validate a file; false (with an error printed) if unusable
+    bool open(const std::string& path);
+
+    const TextureFileHeader& header() const { return *reinterpret_cast<const TextureFileHeader*>(file.data()); }
+    Level level(unsigned int index) const;
+    // the whole file, e.g. for hashing
+    std::string_view bytes() const { return file.bytes(); }
+
+    // write a mip chain of 8-bit pixels
+    static bool write(const std::string& path, const std::vector<MipLevel>& chain, int channels, bool srgb);
+    // write levels whose pixels are already in the given GL format, e.g.
+    // compressed blocks (format and type 0)
+    static bool write(const std::string& path, const std::vector<MipLevel>& levels, int channels,
+                      std::uint32_t internalFormat, std::uint32_t format, std::uint32_t type, std::uint32_t flags);
+
+  private:
+    MappedFile file;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#include "texture_lod.h"
+
+#include <algorithm>
+#include <cmath>
+
+float mipLevelForTriangle(const glm::mat4& clipFromObject, glm::vec2 viewport, const glm::vec3 positions[3],
+                          const glm::vec2 uvs[3], glm::vec2 textureSize)
+{
+  glm::vec2 screen[3];
+  for (int i = 0; i < 3; i++)
+  {
+    glm::vec4 clip = clipFromObject * glm::vec4(positions[i], 1.0f);
+    if (clip.w <= 0.0f)
+      return 0.0f;
+    screen[i] = (glm::vec2(clip) / clip.w * 0.5f + 0.5f) * viewport;
+  }
+
+  // texels per pixel: solve texel edges = J * screen edges for J, whose
+  // columns are the derivatives along x and y
+  glm::mat2 screenEdges(screen[1] - screen[0], screen[2] - screen[0]);
+  glm::mat2 texelEdges((uvs[1] - uvs[0]) * textureSize, (uvs[2] - uvs[0]) * textureSize);
+  float maxLevel = std::log2(std::max(textureSize.x, textureSize.y));
+  if (std::abs(glm::determinant(screenEdges)) < 1e-6f)
+    return maxLevel;
+  glm::mat2 derivatives = texelEdges * glm::inverse(screenEdges);
+
+  float rho = std::max(glm::length(derivatives[0]), glm::length(derivatives[1]));
+  return rho > 1.0f ? std::min(std::log2(rho), maxLevel) : 0.0f;
+}
+
+float mipLevelForMesh(const glm::mat4& clipFromObject, glm::vec2 viewport, const float* vertices, int stride,
+                      int positionOffset, int uvOffset, const unsigned int* indices, int indexCount,
+                      glm::vec2 textureSize)
+{
+  float level = std::log2(std::max(textureSize.x, textureSize.y));
+  for (int t = 0; t + 2 < indexCount; t += 3)
+  {
+    glm::vec3 positions[3];
+    glm::vec2 uvs[3];
+    for (int corner = 0; corner < 3; corner++)
+    {
+      const float* vertex = vertices + static_cast<std::size_t>(indices[t + corner]) * stride;
+      positions[corner] = glm::vec3(vertex[positionOffset], vertex[positionOffset + 1], vertex[positionOffset + 2]);
+      uvs[corner] = glm::vec2(vertex[uvOffset], vertex[uvOffset + 1]);
+    }
+    level = std::min(level, mipLevelForTriangle(clipFromObject, viewport, positions, uvs, textureSize));
+  }
+  return level;
+}
@@ -0,0 +1,30 @@
+#ifndef TEXTURE_LOD_H
+#define TEXTURE_LOD_H
+
+#include <glm/glm.hpp>
+
+// The mip level GL samples for a triangle, worked out on the CPU so a
+// streamer knows which levels a frame needs before it draws.
+//
+// GL picks lambda = log2(rho) per pixel, where rho is the longer of the
+// texel-space derivatives d(uv)/dx and d(uv)/dy. Here the derivatives come
+// from the triangle's projected corners, i.e. they are the average over the
+// triangle: exact for an affine mapping, and close enough in perspective
+// unless one triangle spans a wide range of depths.
+//
+//   viewport    - size of the render target in pixels
+//   textureSize - size of level 0 in texels
+//
+// Returns the finest level the triangle needs: 0 when magnified, and 0 as
+// well when a corner is behind the camera and nothing can be said.
+// Triangles seen edge-on only need the 1x1 level.
+float mipLevelForTriangle(const glm::mat4& clipFromObject, glm::vec2 viewport, const glm::vec3 positions[3],
+                          const glm::vec2 uvs[3], glm::vec2 textureSize);
+
+// the same for an indexed triangle list with interleaved vertices (`stride`
+// and the offsets in floats): the finest level any triangle needs
+float mipLevelForMesh(const glm::mat4& clipFromObject, glm::vec2 viewport, const float* vertices, int stride,
+                      int positionOffset, int uvOffset, const unsigned int* indices, int indexCount,
+                      glm::vec2 textureSize);
+
+#endif
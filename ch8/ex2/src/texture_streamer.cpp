@@ -0,0 +1,361 @@
+#include <glad/glad.h>
+
+#include "texture_streamer.h"
+#include "gl_state.h"
+#include "gpu_memory.h"
+#include "mapped_file.h"
+#include "mip_generator.h"
+#include "block_compression.h"
+#include "stb_image.h"
+#include "texture_2d.h"
+#include "texture_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+TextureStreamer::TextureStreamer(unsigned int workers, unsigned int slotCount, std::size_t slotBytes)
+  : slotSize(slotBytes)
+{
+  for (unsigned int i = 0; i < slotCount; i++)
+  {
+    slots.push_back({ 0, nullptr });
+    glGenBuffers(1, &slots.back().buffer);
+    map(static_cast<int>(i));
+  }
+  GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  if (workers == 0)
+    workers = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned int i = 0; i < workers; i++)
+    threads.emplace_back(&TextureStreamer::work, this);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  jobReady.notify_all();
+  slotFree.notify_all();
+  for (std::thread& thread : threads)
+    thread.join();
+
+  for (Decoded& image : decoded)
+    stbi_image_free(image.pixels);
+  for (Slot& slot : slots)
+  {
+    GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    GpuMemory::deleteBuffer(slot.buffer);
+  }
+}
+
+void TextureStreamer::map(int slot)
+{
+  // orphan the storage a previous upload may still be reading from, so
+  // mapping never waits for it
+  GpuMemory::bufferData(GpuMemory::Resource::Staging, GL_PIXEL_UNPACK_BUFFER, slots[slot].buffer, slotSize, nullptr,
+                        GL_STREAM_DRAW);
+  slots[slot].mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, slotSize,
+                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (!slots[slot].mapped)
+  {
+    std::cout << "ERROR::TEXTURE_STREAMER::MAP_FAILED" << std::endl;
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  freeSlots.push_back(slot);
+}
+
+std::uint64_t TextureStreamer::load(Texture2D& texture, std::string path, bool flipVertically, bool srgb, Done done)
+{
+  std::uint64_t ticket = nextTicket++;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.push_back({ ticket, &texture, std::move(path), flipVertically, std::move(done), -1, 0, maxImageSize, srgb });
+  }
+  counters.queued++;
+  jobReady.notify_one();
+  return ticket;
+}
+
+std::uint64_t TextureStreamer::loadLevel(Texture2D& texture, std::string path, int level, Done done)
+{
+  std::uint64_t ticket = nextTicket++;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.push_back({ ticket, &texture, std::move(path), false, std::move(done), level, texture.internalFormat() });
+  }
+  counters.queued++;
+  jobReady.notify_one();
+  return ticket;
+}
+
+void TextureStreamer::cancel(std::uint64_t ticket)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto queued = std::find_if(jobs.begin(), jobs.end(), [&](const Job& job) { return job.ticket == ticket; });
+  if (queued != jobs.end())
+    jobs.erase(queued);
+  else
+    cancelled.push_back(ticket);
+}
+
+bool TextureStreamer::idle() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return jobs.empty() && decoding == 0 && decoded.empty();
+}
+
+void TextureStreamer::work()
+{
+  while (true)
+  {
+    Decoded image;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+      if (stopping)
+        return;
+      image.job = std::move(jobs.front());
+      jobs.pop_front();
+      decoding++;
+    }
+
+    if (image.job.level >= 0)
+      readLevel(image);
+    else
+      decodeImage(image);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    decoded.push_back(std::move(image));
+    decoding--;
+    if (stopping)
+      return;
+  }
+}
+
+int TextureStreamer::takeSlot()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  slotFree.wait(lock, [this] { return stopping || !freeSlots.empty(); });
+  if (stopping)
+    return -1;
+  int slot = freeSlots.back();
+  freeSlots.pop_back();
+  return slot;
+}
+
+void TextureStreamer::decodeImage(Decoded& image)
+{
+  // decoded straight from the page cache, unflipped: the flip happens
+  // in the copy to the slot instead of as a pass of its own
+  {
+    MappedFile file;
+    if (file.open(image.job.path))
+    {
+      stbi_set_flip_vertically_on_load_thread(false);
+      image.pixels = stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &image.width, &image.height,
+                                           &image.channels, 0);
+    }
+  }
+  if (!image.pixels)
+  {
+    std::cout << "ERROR::TEXTURE_STREAMER::DECODE_FAILED " << image.job.path << std::endl;
+    return;
+  }
+
+  if (image.job.maxSize > 0 && std::max(image.width, image.height) > image.job.maxSize)
+  {
+    MipOptions options;
+    options.maxSize = image.job.maxSize;
+    options.srgb = image.job.srgb;
+    MipLevel level = downscaleToFit(image.pixels, image.width, image.height, image.channels, options);
+    stbi_image_free(image.pixels);
+    image.pixels = nullptr;
+    image.width = level.width;
+    image.height = level.height;
+    image.levelData = std::move(level.pixels);
+  }
+  unsigned char* pixels = image.pixels ? image.pixels : image.levelData.data();
+
+  std::size_t rowBytes = static_cast<std::size_t>(image.width) * image.channels;
+  image.bytes = rowBytes * image.height;
+  if (image.bytes <= slotSize)
+  {
+    image.slot = takeSlot();
+    if (image.slot < 0)
+      return;
+    // the slot stays mapped until the GL thread picks it up
+    unsigned char* destination = static_cast<unsigned char*>(slots[image.slot].mapped);
+    if (image.job.flipVertically)
+    {
+      for (int row = 0; row < image.height; row++)
+        std::memcpy(destination + (image.height - 1 - row) * rowBytes, pixels + row * rowBytes, rowBytes);
+    }
+    else
+    {
+      std::memcpy(destination, pixels, image.bytes);
+    }
+    stbi_image_free(image.pixels);
+    image.pixels = nullptr;
+    image.levelData = {};
+  }
+  else if (image.job.flipVertically)
+  {
+    // kept for a direct upload: flip in place
+    for (int top = 0, bottom = image.height - 1; top < bottom; top++, bottom--)
+      std::swap_ranges(pixels + top * rowBytes, pixels + (top + 1) * rowBytes, pixels + bottom * rowBytes);
+  }
+}
+
+void TextureStreamer::readLevel(Decoded& image)
+{
+  TextureFile file;
+  if (!file.open(image.job.path) || image.job.level >= static_cast<int>(file.header().levels))
+  {
+    std::cout << "ERROR::TEXTURE_STREAMER::LEVEL_NOT_READ " << image.job.path << " " << image.job.level << std::endl;
+    return;
+  }
+
+  const TextureFileHeader& header = file.header();
+  TextureFile::Level level = file.level(image.job.level);
+  const unsigned char* source = level.data;
+  image.bytes = level.size;
+  image.format = header.format;
+  image.type = header.type;
+
+  // blocks for a texture without the block format are decoded here
+  BlockFormat blockFormat;
+  bool srgb;
+  std::vector<unsigned char> pixels;
+  if (header.format == 0 && image.job.internalFormat != header.internalFormat
+      && blockFormatFromInternalFormat(header.internalFormat, blockFormat, srgb))
+  {
+    pixels = decompressImage(level.data, level.width, level.height, blockFormat);
+    source = pixels.data();
+    image.bytes = pixels.size();
+    image.format = GL_RGBA;
+    image.type = GL_UNSIGNED_BYTE;
+  }
+
+  // reading the mapping is what pulls the level from disk
+  if (image.bytes <= slotSize)
+  {
+    image.slot = takeSlot();
+    if (image.slot < 0)
+      return;
+    std::memcpy(slots[image.slot].mapped, source, image.bytes);
+  }
+  else if (!pixels.empty())
+  {
+    image.levelData = std::move(pixels);
+  }
+  else
+  {
+    image.levelData.assign(source, source + image.bytes);
+  }
+  image.width = level.width;
+  image.height = level.height;
+  image.channels = static_cast<int>(header.channels);
+}
+
+void TextureStreamer::update(std::size_t byteBudget)
+{
+  std::vector<Decoded> batch;
+  std::vector<int> unused;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::size_t spent = 0;
+    while (!decoded.empty())
+    {
+      Decoded& image = decoded.front();
+      auto dropped = std::find(cancelled.begin(), cancelled.end(), image.job.ticket);
+      if (dropped != cancelled.end())
+      {
+        // its slot is still mapped and can go straight back
+        cancelled.erase(dropped);
+        if (image.slot >= 0)
+          unused.push_back(image.slot);
+        stbi_image_free(image.pixels);
+        decoded.pop_front();
+        continue;
+      }
+
+      if (!batch.empty() && spent + image.bytes > byteBudget)
+        break;
+      spent += image.bytes;
+      batch.push_back(std::move(image));
+      decoded.pop_front();
+    }
+    freeSlots.insert(freeSlots.end(), unused.begin(), unused.end());
+  }
+  if (!unused.empty())
+    slotFree.notify_all();
+  if (batch.empty())
+    return;
+
+  for (Decoded& image : batch)
+  {
+    if (image.width == 0)
+    {
+      counters.failed++;
+      if (image.job.done)
+        image.job.done(0, 0, 0);
+      continue;
+    }
+
+    upload(image);
+    counters.uploaded++;
+    counters.bytesUploaded += image.bytes;
+    if (image.job.done)
+      image.job.done(image.width, image.height, image.channels);
+  }
+  // a bound unpack buffer would turn later client-memory uploads into offsets
+  GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  slotFree.notify_all();
+}
+
+void TextureStreamer::upload(Decoded& image)
+{
+  Texture2D& texture = *image.job.texture;
+  // storage first: specifying it unbinds the unpack buffer
+  if (image.job.level >= 0)
+    texture.reserveLevel(image.job.level);
+  else
+    texture.allocate(image.width, image.height, Texture2D::internalFormatFor(image.channels, image.job.srgb));
+
+  const void* source = image.pixels ? static_cast<const void*>(image.pixels) : image.levelData.data();
+  if (image.slot >= 0)
+  {
+    // sourced from the buffer: the call returns before the copy is done
+    GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, slots[image.slot].buffer);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    source = nullptr;
+  }
+  else
+  {
+    GLState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    counters.direct++;
+  }
+
+  if (image.job.level >= 0)
+  {
+    if (image.format == 0)
+      texture.uploadCompressed(image.job.level, source, image.bytes);
+    else
+      texture.upload(image.job.level, image.format, image.type, source);
+  }
+  else
+  {
+    texture.upload(0, Texture2D::pixelFormatFor(image.channels), GL_UNSIGNED_BYTE, source);
+    texture.generateMipmaps();
+  }
+
+  if (image.slot >= 0)
+    map(image.slot);
+  stbi_image_free(image.pixels);
+}
@@ -0,0 +1,156 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Texture2D;
+
+// Loads images into textures in three stages:
+//
+//   1. a pool of worker threads reads and decodes the files in parallel,
+//   2. each worker copies its pixels into a mapped pixel unpack buffer
+//      taken from a small ring of staging slots,
+//   3. update() on the GL thread unmaps filled slots, allocates each
+//      texture's storage and issues glTexSubImage2D from them, up to a
+//      byte budget per call, then orphans and maps the slot again for
+//      the next image.
+//
+// The upload from a buffer returns without waiting for the copy, and a
+// worker only blocks when every slot is waiting for the GL thread. Images
+// larger than a slot are kept in memory and uploaded directly.
+//
+// Images larger than clampImages() are reduced on the worker to the
+// largest mip level that fits (see downscaleToFit()) before they take a
+// slot.
+//
+// Single levels of cooked files go the same way with loadLevel(): the
+// worker reads the level from the mapping (and decodes its blocks if the
+// texture holds decoded pixels) and update() uploads it into the level.
+class TextureStreamer
+{
+  public:
+    // runs on the GL thread once the texture has its storage and pixels,
+    // or with a width of 0 if the image couldn't be loaded; for a level,
+    // the size is the level's
+    using Done = std::function<void(int width, int height, int channels)>;
+
+    struct Stats
+    {
+      unsigned int queued = 0;
+      unsigned int uploaded = 0;
+      unsigned int failed = 0;
+      // uploads that didn't fit in a slot
+      unsigned int direct = 0;
+      std::size_t bytesUploaded = 0;
+    };
+
+    // workers = 0 starts one per hardware thread
+    explicit TextureStreamer(unsigned int workers = 0, unsigned int slotCount = 8, std::size_t slotBytes = 4 << 20);
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // queue an image for a texture without storage yet, which the caller
+    // owns and keeps in place until done or cancel(); returns a ticket for
+    // cancel(). `srgb` picks the sRGB format for color images
+    std::uint64_t load(Texture2D& texture, std::string path, bool flipVertically, bool srgb, Done done);
+    // queue one level of a cooked file (see TextureFile) for a texture with
+    // storage for the coarser levels (see Texture2D::allocateFrom); the
+    // level gets storage and pixels, but moving the base level to it is up
+    // to `done`
+    std::uint64_t loadLevel(Texture2D& texture, std::string path, int level, Done done);
+    // images queued from now on that are larger than `size` texels are
+    // reduced to fit; 0 uploads them whole
+    void clampImages(int size) { maxImageSize = size; }
+    // drop a queued or in-flight load, e.g. before deleting its texture
+    void cancel(std::uint64_t ticket);
+    // GL thread, once per frame: upload finished images until byteBudget is
+    // spent (at least one, so a large image can't stall the queue)
+    void update(std::size_t byteBudget);
+    // nothing queued, decoding or waiting for upload
+    bool idle() const;
+
+    Stats stats() const { return counters; }
+
+  private:
+    struct Job
+    {
+      std::uint64_t ticket;
+      Texture2D* texture;
+      std::string path;
+      bool flipVertically;
+      Done done;
+      // a level of a cooked file, or -1 for an image
+      int level = -1;
+      // of the texture, when the level was queued
+      GLenum internalFormat = 0;
+      // of an image, when it was queued
+      int maxSize = 0;
+      bool srgb = true;
+    };
+
+    struct Decoded
+    {
+      Job job;
+      int width = 0;
+      int height = 0;
+      int channels = 0;
+      std::size_t bytes = 0;
+      // staging slot holding the pixels, or -1 with the pixels kept here:
+      // decoded by stb_image for images, copied for levels and clamped
+      // images
+      int slot = -1;
+      unsigned char* pixels = nullptr;
+      std::vector<unsigned char> levelData;
+      // pixel format and type of a level, 0 if it holds compressed blocks
+      GLenum format = 0;
+      GLenum type = 0;
+    };
+
+    struct Slot
+    {
+      unsigned int buffer;
+      void* mapped;
+    };
+
+    std::size_t slotSize;
+    std::vector<Slot> slots;
+    std::vector<std::thread> threads;
+
+    // guards everything below
+    mutable std::mutex mutex;
+    std::condition_variable jobReady;
+    std::condition_variable slotFree;
+    std::deque<Job> jobs;
+    std::deque<Decoded> decoded;
+    std::vector<int> freeSlots;
+    std::vector<std::uint64_t> cancelled;
+    unsigned int decoding = 0;
+    bool stopping = false;
+
+    // GL thread only
+    std::uint64_t nextTicket = 1;
+    int maxImageSize = 0;
+    Stats counters;
+
+    void work();
+    void decodeImage(Decoded& image);
+    void readLevel(Decoded& image);
+    // wait for a free staging slot; -1 when stopping
+    int takeSlot();
+    void upload(Decoded& image);
+    void map(int slot);
+};
+
+#endif
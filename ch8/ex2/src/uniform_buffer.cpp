@@ -0,0 +1,118 @@
+#include <glad/glad.h>
+
+#include "uniform_buffer.h"
+#include "gl_state.h"
+#include "gpu_memory.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+UniformBuffer::UniformBuffer(const Shader& shader, const char* blockName, unsigned int binding, std::size_t slotCount)
+  : name(blockName), bindingPoint(binding), slots(slotCount)
+{
+  if (slotCount == 0)
+  {
+    std::cout << "ERROR::UNIFORM_BUFFER::NO_SLOTS " << blockName << std::endl;
+    return;
+  }
+
+  unsigned int blockIndex = glGetUniformBlockIndex(shader.ID, blockName);
+  if (blockIndex == GL_INVALID_INDEX)
+  {
+    std::cout << "ERROR::UNIFORM_BUFFER::BLOCK_NOT_FOUND " << blockName << std::endl;
+    return;
+  }
+
+  int size = 0;
+  int memberCount = 0;
+  glGetActiveUniformBlockiv(shader.ID, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+  glGetActiveUniformBlockiv(shader.ID, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &memberCount);
+  dataSize = size;
+
+  // member offsets as laid out by the driver for std140
+  std::vector<int> indices(memberCount);
+  std::vector<int> offsets(memberCount);
+  glGetActiveUniformBlockiv(shader.ID, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, indices.data());
+  std::vector<unsigned int> uniformIndices(indices.begin(), indices.end());
+  glGetActiveUniformsiv(shader.ID, memberCount, uniformIndices.data(), GL_UNIFORM_OFFSET, offsets.data());
+
+  int maxLength = 0;
+  glGetProgramiv(shader.ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+  std::string memberName(maxLength, '\0');
+  for (int i = 0; i < memberCount; i++)
+  {
+    int length = 0;
+    glGetActiveUniformName(shader.ID, uniformIndices[i], maxLength, &length, memberName.data());
+    members.push_back({ memberName.substr(0, length), offsets[i] });
+  }
+
+  int alignment = 0;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  alignment = std::max(alignment, 1);
+  stride = (dataSize + alignment - 1) / alignment * alignment;
+
+  mirror.assign(stride * slots, 0);
+  dirtyBegin = mirror.size();
+
+  glGenBuffers(1, &buffer);
+  GpuMemory::bufferData(GpuMemory::Resource::Buffer, GL_UNIFORM_BUFFER, buffer, mirror.size(), NULL, GL_DYNAMIC_DRAW);
+
+  attach(shader);
+}
+
+UniformBuffer::~UniformBuffer()
+{
+  GpuMemory::deleteBuffer(buffer);
+}
+
+void UniformBuffer::attach(const Shader& shader) const
+{
+  unsigned int blockIndex = glGetUniformBlockIndex(shader.ID, name.c_str());
+  if (blockIndex != GL_INVALID_INDEX)
+    glUniformBlockBinding(shader.ID, blockIndex, bindingPoint);
+}
+
+int UniformBuffer::memberOffset(std::string_view memberName) const
+{
+  for (const Member& member : members)
+    if (member.name == memberName)
+      return member.offset;
+  return -1;
+}
+
+void UniformBuffer::set(std::size_t slot, int offset, const void* data, std::size_t size)
+{
+  if (offset < 0 || slot >= slots || offset + size > dataSize)
+    return;
+
+  std::size_t begin = slot * stride + offset;
+  std::memcpy(mirror.data() + begin, data, size);
+  dirtyBegin = std::min(dirtyBegin, begin);
+  dirtyEnd = std::max(dirtyEnd, begin + size);
+}
+
+void UniformBuffer::flush()
+{
+  if (buffer == 0 || dirtyBegin >= dirtyEnd)
+    return;
+
+  GLState::bindBuffer(GL_UNIFORM_BUFFER, buffer);
+  // rewriting everything: orphan the old storage so the driver does not
+  // have to wait for draws still reading it
+  std::size_t used = (slots - 1) * stride + dataSize;
+  if (dirtyBegin == 0 && dirtyEnd >= used)
+    GpuMemory::bufferData(GpuMemory::Resource::Buffer, GL_UNIFORM_BUFFER, buffer, mirror.size(), NULL,
+                          GL_DYNAMIC_DRAW);
+  glBufferSubData(GL_UNIFORM_BUFFER, dirtyBegin, dirtyEnd - dirtyBegin, mirror.data() + dirtyBegin);
+
+  dirtyBegin = mirror.size();
+  dirtyEnd = 0;
+}
+
+void UniformBuffer::bind(std::size_t slot) const
+{
+  if (buffer == 0 || slot >= slots)
+    return;
+  GLState::bindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, buffer, slot * stride, dataSize);
+}
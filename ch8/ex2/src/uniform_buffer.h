@@ -0,0 +1,72 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "shader.h"
+
+// A std140 uniform block backed by one buffer object with one slot per
+// draw. Values are written into a CPU mirror, and flush() uploads the dirty
+// byte range with a single glBufferSubData per frame. Each draw then selects
+// its slot with glBindBufferRange instead of issuing its own glUniform*
+// calls.
+class UniformBuffer
+{
+  public:
+    // reflect the layout of blockName from a linked program; without the
+    // block, or with no slots, the buffer stays empty and every call is a
+    // no-op
+    UniformBuffer(const Shader& shader, const char* blockName, unsigned int bindingPoint, std::size_t slots);
+    ~UniformBuffer();
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    // point the block of another program (or a reloaded one) at our binding
+    void attach(const Shader& shader) const;
+
+    // byte offset of a block member (-1 if the block has no such member)
+    int memberOffset(std::string_view name) const;
+
+    // write into the CPU mirror of one slot
+    void set(std::size_t slot, int offset, const void* data, std::size_t size);
+    template <class T>
+    void set(std::size_t slot, int offset, const T& value)
+    {
+      set(slot, offset, &value, sizeof(T));
+    }
+
+    // upload everything written since the last flush
+    void flush();
+    // bind one slot's range to the binding point
+    void bind(std::size_t slot) const;
+
+    std::size_t blockSize() const { return dataSize; }
+    std::size_t slotCount() const { return slots; }
+
+  private:
+    struct Member
+    {
+      std::string name;
+      int offset;
+    };
+
+    std::string name;
+    unsigned int bindingPoint;
+    unsigned int buffer = 0;
+    std::size_t dataSize = 0;
+    // dataSize rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    std::size_t stride = 0;
+    std::size_t slots;
+    std::vector<Member> members;
+    std::vector<unsigned char> mirror;
+    std::size_t dirtyBegin = 0;
+    std::size_t dirtyEnd = 0;
+};
+
+#endif
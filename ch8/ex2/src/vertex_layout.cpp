@@ -0,0 +1,43 @@
+#include "vertex_layout.h"
+
+#include <bit>
+
+std::uint16_t floatToHalf(float value)
+{
+  std::uint32_t bits = std::bit_cast<std::uint32_t>(value);
+  std::uint16_t sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000);
+  std::uint32_t magnitude = bits & 0x7fffffff;
+
+  // NaN stays NaN, anything at or past 65520 rounds to infinity
+  if (magnitude > 0x7f800000)
+    return sign | 0x7e00;
+  if (magnitude >= 0x477ff000)
+    return sign | 0x7c00;
+  // below the smallest normal half: rounded in the float adder, whose
+  // 0.5 makes the result's low mantissa bits the half's
+  if (magnitude < 0x38800000)
+  {
+    float rounded = std::bit_cast<float>(magnitude) + 0.5f;
+    return sign | static_cast<std::uint16_t>(std::bit_cast<std::uint32_t>(rounded) - 0x3f000000);
+  }
+  // rebias the exponent and round the 13 dropped bits to nearest even
+  std::uint32_t odd = (magnitude >> 13) & 1;
+  magnitude += 0xc8000fff + odd;
+  return sign | static_cast<std::uint16_t>(magnitude >> 13);
+}
+
+float halfToFloat(std::uint16_t value)
+{
+  std::uint32_t sign = static_cast<std::uint32_t>(value & 0x8000) << 16;
+  std::uint32_t exponent = (value >> 10) & 0x1f;
+  std::uint32_t mantissa = value & 0x3ff;
+  if (exponent == 0)
+  {
+    // zero or subnormal: mantissa * 2^-24
+    float magnitude = mantissa * (1.0f / 16777216.0f);
+    return std::bit_cast<float>(sign | std::bit_cast<std::uint32_t>(magnitude));
+  }
+  if (exponent == 31)
+    return std::bit_cast<float>(sign | 0x7f800000 | mantissa << 13);
+  return std::bit_cast<float>(sign | (exponent + 112) << 23 | mantissa << 13);
+}
@@ -0,0 +1,304 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <utility>
+
+// Interleaved vertex formats described by types, in place of hand-counted
+// strides and offsets:
+//
+//   using QuadLayout = VertexLayout<Position3f, Color3f, UV2f>;
+//   QuadLayout::Vertex vertices[] = { { { 0.5f, 0.5f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f } }, ... };
+//   QuadLayout::setup();
+//
+// Offsets and the stride are constexpr, and setup() unrolls into one
+// glVertexAttribPointer/glEnableVertexAttribArray pair per attribute with
+// constant arguments. Each attribute goes to the location of its semantic,
+// so the shaders don't depend on the order or on which others are there.
+//
+// Vertices are built from floats whatever the stored format, so a layout
+// can swap Color3f for Color4u8 or UV2f for UV2h without touching the
+// vertex data or the draws. Formats GL can't read, a semantic given twice,
+// a vertex with the wrong number of attributes or asking a layout for an
+// attribute it lacks don't compile.
+
+// what an attribute holds; the value is its location in the shaders
+enum class VertexSemantic : GLuint
+{
+  Position = 0,
+  Color = 1,
+  UV = 2,
+  Normal = 3
+};
+
+// IEEE half floats for GL_HALF_FLOAT, rounded to nearest
+std::uint16_t floatToHalf(float value);
+float halfToFloat(std::uint16_t value);
+
+// one attribute stored as `Components` values of `Type`, normalized to
+// [0, 1] or [-1, 1] if `Normalized`. It is built from 2 floats for UVs and
+// 3 for the rest; stored components beyond those are 1 (w, alpha)
+template <VertexSemantic Semantic, GLint Components, GLenum Type, GLboolean Normalized = GL_FALSE>
+struct VertexAttribute
+{
+  static constexpr VertexSemantic semantic = Semantic;
+  static constexpr GLint components = Components;
+  static constexpr GLenum type = Type;
+  static constexpr GLboolean normalized = Normalized;
+  static constexpr int valueCount = Semantic == VertexSemantic::UV ? 2 : 3;
+  using Value = std::array<float, valueCount>;
+
+  static constexpr std::size_t componentSize()
+  {
+    switch (Type)
+    {
+      case GL_FLOAT:
+        return 4;
+      case GL_HALF_FLOAT:
+      case GL_UNSIGNED_SHORT:
+      case GL_SHORT:
+        return 2;
+      case GL_UNSIGNED_BYTE:
+      case GL_BYTE:
+        return 1;
+    }
+    return 0;
+  }
+
+  static constexpr bool packed = Type == GL_INT_2_10_10_10_REV;
+  static constexpr std::size_t size = packed ? 4 : componentSize() * Components;
+
+  static_assert(Components >= 1 && Components <= 4, "GL attributes have 1 to 4 components");
+  static_assert(packed || componentSize() > 0, "unsupported vertex attribute type");
+  static_assert(!packed || (Components == 4 && Normalized), "2_10_10_10 attributes are 4 normalized components");
+  static_assert(Normalized || Type == GL_FLOAT || Type == GL_HALF_FLOAT,
+                "integer attributes need to be normalized to reach the shader as floats");
+  static_assert(Components >= valueCount, "the format has fewer components than the attribute has values");
+  // attributes off a 4-byte boundary are fetched slowly or not at all
+  static_assert(size % 4 == 0, "pad the attribute to a multiple of 4 bytes with another component");
+
+  static void encode(const Value& value, unsigned char* out)
+  {
+    float v[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    std::copy(value.begin(), value.end(), v);
+    if constexpr (packed)
+    {
+      auto snorm = [](float x, int bits)
+      {
+        int range = (1 << (bits - 1)) - 1;
+        int mask = (1 << bits) - 1;
+        return static_cast<std::uint32_t>(static_cast<int>(std::lround(std::clamp(x, -1.0f, 1.0f) * range)) & mask);
+      };
+      std::uint32_t bits = snorm(v[0], 10) | snorm(v[1], 10) << 10 | snorm(v[2], 10) << 20 | snorm(v[3], 2) << 30;
+      std::memcpy(out, &bits, 4);
+    }
+    else
+    {
+      for (int c = 0; c < Components; c++)
+        storeComponent(v[c], out + c * componentSize());
+    }
+  }
+
+  static Value decode(const unsigned char* in)
+  {
+    Value value;
+    if constexpr (packed)
+    {
+      std::uint32_t bits;
+      std::memcpy(&bits, in, 4);
+      for (int c = 0; c < valueCount; c++)
+      {
+        // sign-extend each 10-bit field
+        int field = static_cast<int>(bits << (22 - 10 * c)) >> 22;
+        value[c] = std::max(field / 511.0f, -1.0f);
+      }
+    }
+    else
+    {
+      for (int c = 0; c < valueCount; c++)
+        value[c] = loadComponent(in + c * componentSize());
+    }
+    return value;
+  }
+
+  private:
+    static void storeComponent(float x, unsigned char* out)
+    {
+      if constexpr (Type == GL_FLOAT)
+        std::memcpy(out, &x, 4);
+      else if constexpr (Type == GL_HALF_FLOAT)
+      {
+        std::uint16_t half = floatToHalf(x);
+        std::memcpy(out, &half, 2);
+      }
+      else if constexpr (Type == GL_UNSIGNED_BYTE)
+        *out = static_cast<std::uint8_t>(std::lround(std::clamp(x, 0.0f, 1.0f) * 255.0f));
+      else if constexpr (Type == GL_BYTE)
+        *out = static_cast<std::uint8_t>(static_cast<std::int8_t>(std::lround(std::clamp(x, -1.0f, 1.0f) * 127.0f)));
+      else if constexpr (Type == GL_UNSIGNED_SHORT)
+      {
+        auto unorm = static_cast<std::uint16_t>(std::lround(std::clamp(x, 0.0f, 1.0f) * 65535.0f));
+        std::memcpy(out, &unorm, 2);
+      }
+      else
+      {
+        auto snorm = static_cast<std::int16_t>(std::lround(std::clamp(x, -1.0f, 1.0f) * 32767.0f));
+        std::memcpy(out, &snorm, 2);
+      }
+    }
+
+    static float loadComponent(const unsigned char* in)
+    {
+      if constexpr (Type == GL_FLOAT)
+      {
+        float x;
+        std::memcpy(&x, in, 4);
+        return x;
+      }
+      else if constexpr (Type == GL_HALF_FLOAT)
+      {
+        std::uint16_t half;
+        std::memcpy(&half, in, 2);
+        return halfToFloat(half);
+      }
+      else if constexpr (Type == GL_UNSIGNED_BYTE)
+        return *in / 255.0f;
+      else if constexpr (Type == GL_BYTE)
+        return std::max(static_cast<std::int8_t>(*in) / 127.0f, -1.0f);
+      else if constexpr (Type == GL_UNSIGNED_SHORT)
+      {
+        std::uint16_t unorm;
+        std::memcpy(&unorm, in, 2);
+        return unorm / 65535.0f;
+      }
+      else
+      {
+        std::int16_t snorm;
+        std::memcpy(&snorm, in, 2);
+        return std::max(snorm / 32767.0f, -1.0f);
+      }
+    }
+};
+
+using Position3f = VertexAttribute<VertexSemantic::Position, 3, GL_FLOAT>;
+// w = 1, padding the halves to 8 bytes
+using Position4h = VertexAttribute<VertexSemantic::Position, 4, GL_HALF_FLOAT>;
+using Color3f = VertexAttribute<VertexSemantic::Color, 3, GL_FLOAT>;
+// alpha = 1
+using Color4u8 = VertexAttribute<VertexSemantic::Color, 4, GL_UNSIGNED_BYTE, GL_TRUE>;
+using UV2f = VertexAttribute<VertexSemantic::UV, 2, GL_FLOAT>;
+using UV2h = VertexAttribute<VertexSemantic::UV, 2, GL_HALF_FLOAT>;
+// UVs within [0, 1] only, e.g. atlas coordinates
+using UV2u16 = VertexAttribute<VertexSemantic::UV, 2, GL_UNSIGNED_SHORT, GL_TRUE>;
+using Normal3f = VertexAttribute<VertexSemantic::Normal, 3, GL_FLOAT>;
+using Normal4i10 = VertexAttribute<VertexSemantic::Normal, 4, GL_INT_2_10_10_10_REV, GL_TRUE>;
+
+template <typename... Attributes>
+class VertexLayout
+{
+  static_assert(sizeof...(Attributes) > 0, "a vertex layout needs an attribute");
+
+  static constexpr std::array<VertexSemantic, sizeof...(Attributes)> semantics = { Attributes::semantic... };
+
+  static constexpr bool semanticsUnique()
+  {
+    for (std::size_t i = 0; i < semantics.size(); i++)
+      for (std::size_t j = i + 1; j < semantics.size(); j++)
+        if (semantics[i] == semantics[j])
+          return false;
+    return true;
+  }
+  static_assert(semanticsUnique(), "a vertex layout has each semantic once");
+
+  public:
+    // of each attribute from the start of a vertex, in layout order
+    static constexpr std::array<std::size_t, sizeof...(Attributes)> offsets = []
+    {
+      std::array<std::size_t, sizeof...(Attributes)> result{};
+      std::size_t sizes[] = { Attributes::size... };
+      for (std::size_t i = 1; i < result.size(); i++)
+        result[i] = result[i - 1] + sizes[i - 1];
+      return result;
+    }();
+    static constexpr std::size_t stride = (Attributes::size + ...);
+
+    template <VertexSemantic Semantic>
+    static constexpr bool has = ((Attributes::semantic == Semantic) || ...);
+
+    template <VertexSemantic Semantic>
+    static constexpr std::size_t indexOf()
+    {
+      static_assert(has<Semantic>, "the vertex layout has no attribute with this semantic");
+      std::size_t index = 0;
+      while (semantics[index] != Semantic)
+        index++;
+      return index;
+    }
+
+    template <VertexSemantic Semantic>
+    using Attribute = std::tuple_element_t<indexOf<Semantic>(), std::tuple<Attributes...>>;
+
+    template <VertexSemantic Semantic>
+    static constexpr std::size_t offsetOf = offsets[indexOf<Semantic>()];
+
+    // one vertex as the buffer holds it, built from one value per attribute
+    // in layout order
+    class Vertex
+    {
+      public:
+        Vertex(const typename Attributes::Value&... values)
+        {
+          encode(std::index_sequence_for<Attributes...>{}, values...);
+        }
+
+        template <VertexSemantic Semantic>
+        typename Attribute<Semantic>::Value get() const
+        {
+          return Attribute<Semantic>::decode(bytes + offsetOf<Semantic>);
+        }
+
+      private:
+        unsigned char bytes[stride];
+
+        template <std::size_t... I>
+        void encode(std::index_sequence<I...>, const typename Attributes::Value&... values)
+        {
+          (Attributes::encode(values, bytes + offsets[I]), ...);
+        }
+    };
+    static_assert(sizeof(Vertex) == stride, "vertices are tightly packed");
+
+    // with the vertex array and the vertex buffer bound: point each
+    // attribute's location into the buffer, whose vertices start
+    // `bufferOffset` bytes in
+    static void setup(std::size_t bufferOffset = 0)
+    {
+      setup(std::index_sequence_for<Attributes...>{}, bufferOffset);
+    }
+
+  private:
+    template <std::size_t... I>
+    static void setup(std::index_sequence<I...>, std::size_t bufferOffset)
+    {
+      (enable<Attributes>(bufferOffset + offsets[I]), ...);
+    }
+
+    template <typename Format>
+    static void enable(std::size_t offset)
+    {
+      GLuint location = static_cast<GLuint>(Format::semantic);
+      glVertexAttribPointer(location, Format::components, Format::type, Format::normalized,
+                            static_cast<GLsizei>(stride), reinterpret_cast<const void*>(offset));
+      glEnableVertexAttribArray(location);
+    }
+};
+
+#endif
@@ -0,0 +1,140 @@
+// texture_cooker: converts an image into a cooked, mip-complete ".tex"
+//
+//   texture_cooker [--linear] [--no-flip] [--format auto|rgba|bc1|bc3|bc7]
+//                  [--quality 0..2] [--filter box|kaiser] [--max-size N]
+//                  <input image> <output .tex>
+//
+// Color images are treated as sRGB unless --linear is given (normal maps,
+// masks). Images are flipped to GL's bottom-up row order unless --no-flip.
+// Mips are filtered with alpha weighting (see MipOptions) by a box or a
+// Kaiser filter, and sources larger than --max-size start at the largest
+// mip level that fits.
+// Every level is block compressed unless --format rgba; auto picks BC1 for
+// opaque images and BC3 when there is alpha. The PSNR of the top level is
+// printed so a quality setting can be judged.
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include "block_compression.h"
+#include "mip_chain.h"
+#include "mip_generator.h"
+#include "stb_image.h"
+#include "texture_file.h"
+
+int main(int argc, char* argv[])
+{
+  bool srgb = true;
+  bool flip = true;
+  std::string format = "auto";
+  int quality = 1;
+  std::string filter = "box";
+  int maxSize = 0;
+  std::string input, output;
+  // the whole argument has to be a number in range, else the usage prints
+  bool numbersValid = true;
+  auto parse = [&](const char* text, int& value, int min, int max)
+  {
+    const char* end = text + std::strlen(text);
+    auto [last, error] = std::from_chars(text, end, value);
+    numbersValid = numbersValid && error == std::errc() && last == end && value >= min && value <= max;
+  };
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "--linear")
+      srgb = false;
+    else if (arg == "--no-flip")
+      flip = false;
+    else if (arg == "--format" && i + 1 < argc)
+      format = argv[++i];
+    else if (arg == "--quality" && i + 1 < argc)
+      parse(argv[++i], quality, 0, 2);
+    else if (arg == "--filter" && i + 1 < argc)
+      filter = argv[++i];
+    else if (arg == "--max-size" && i + 1 < argc)
+      parse(argv[++i], maxSize, 0, std::numeric_limits<int>::max());
+    else if (input.empty())
+      input = arg;
+    else
+      output = arg;
+  }
+  if (!numbersValid || output.empty() || (format != "auto" && format != "rgba" && format != "bc1" && format != "bc3" && format != "bc7")
+      || (filter != "box" && filter != "kaiser"))
+  {
+    std::cout << "usage: texture_cooker [--linear] [--no-flip] [--format auto|rgba|bc1|bc3|bc7] [--quality 0..2] "
+                 "[--filter box|kaiser] [--max-size N] <input image> <output .tex>" << std::endl;
+    return 1;
+  }
+
+  int width, height, channels;
+  stbi_set_flip_vertically_on_load(flip);
+  unsigned char* pixels = stbi_load(input.c_str(), &width, &height, &channels, 0);
+  if (!pixels)
+  {
+    std::cout << "ERROR::TEXTURE_COOKER::DECODE_FAILED " << input << ": " << stbi_failure_reason() << std::endl;
+    return 1;
+  }
+
+  // the block formats take RGB or RGBA only
+  if (format == "auto")
+  {
+    bool opaque = true;
+    for (std::size_t i = 3; channels == 4 && opaque && i < static_cast<std::size_t>(width) * height * 4; i += 4)
+      opaque = pixels[i] == 255;
+    format = channels < 3 ? "rgba" : opaque ? "bc1" : "bc3";
+  }
+  else if (format != "rgba" && channels < 3)
+  {
+    std::cout << "ERROR::TEXTURE_COOKER::BLOCK_FORMAT_NEEDS_RGB " << input << std::endl;
+    stbi_image_free(pixels);
+    return 1;
+  }
+
+  MipOptions mipOptions;
+  mipOptions.filter = filter == "kaiser" ? MipFilter::Kaiser : MipFilter::Box;
+  mipOptions.srgb = srgb;
+  mipOptions.maxSize = maxSize;
+  std::vector<MipLevel> chain = generateMipChain(pixels, width, height, channels, mipOptions);
+  stbi_image_free(pixels);
+  width = chain[0].width;
+  height = chain[0].height;
+
+  if (format == "rgba")
+  {
+    if (!TextureFile::write(output, chain, channels, srgb))
+      return 1;
+    std::cout << "Cooked " << input << ": " << width << "x" << height << ", " << channels << " channels, "
+              << chain.size() << " levels" << (srgb ? ", sRGB" : "") << std::endl;
+    return 0;
+  }
+
+  BlockEncoderOptions options;
+  options.format = format == "bc1" ? BlockFormat::BC1 : format == "bc3" ? BlockFormat::BC3 : BlockFormat::BC7;
+  options.quality = quality;
+  double topPsnr = 0.0;
+  std::vector<MipLevel> blocks;
+  for (const MipLevel& level : chain)
+  {
+    blocks.push_back({ level.width, level.height,
+                       compressImage(level.pixels.data(), level.width, level.height, channels, options) });
+    if (blocks.size() == 1)
+    {
+      std::vector<unsigned char> decoded = decompressImage(blocks.back().pixels.data(), level.width, level.height,
+                                                           options.format);
+      int compared = options.format == BlockFormat::BC1 ? 3 : channels;
+      topPsnr = psnr(level.pixels.data(), channels, decoded.data(), 4, level.width, level.height, compared);
+    }
+  }
+
+  if (!TextureFile::write(output, blocks, channels, compressedInternalFormat(options.format, srgb), 0, 0,
+                          srgb ? TextureFile::srgbFlag : 0))
+    return 1;
+  std::cout << "Cooked " << input << ": " << width << "x" << height << ", " << format << " quality "
+            << options.quality << " (" << blockEncoderPath(options) << "), " << chain.size() << " levels"
+            << (srgb ? ", sRGB" : "") << ", PSNR " << topPsnr << " dB" << std::endl;
+  return 0;
+}